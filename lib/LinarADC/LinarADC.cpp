@@ -1,23 +1,38 @@
 #include "LinarADC.h"
+#include <new>
 
 
-const char* LinarADC::formatMessage(const char *format, ...) {
-    static char buffer[128];
-    va_list args;                
-    va_start(args, format);      
-    vsnprintf(buffer, sizeof(buffer), format, args); 
-    va_end(args);                
+namespace {
 
-    return buffer;
+// Lets the storage free what it keeps for a blob being read, on every return path
+class ReadScope {
+public:
+    ReadScope(LinarStorage &store, const char *path) :storage(store), key(path) {}
+    ~ReadScope() { storage.release(key); }
+
+private:
+    LinarStorage &storage;
+    const char *key;
+};
+
+}  // namespace
+
+uint8_t LinarADC::activeResolution = 0;
+
+void LinarADC::logMessage(LinarLogLevel level, const char *format, ...) {
+    uint32_t start = micros();
+    char buffer[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    debugfcn(buffer);
+    logMicros += micros() - start;
 }
 
 void LinarADC::ledIndication(int pin, bool isLong) {
-    if (pin == -1) return;
-    int delayTime = isLong ? 2000 : 250;
-    digitalWrite(pin, LOW);
-    delay(delayTime);
-    digitalWrite(pin, HIGH);
-    delay(250);
+    led.blink(pin, isLong ? 2000 : 250, 250);
 }
 
 bool LinarADC::triggerLed (const bool status){
@@ -30,86 +45,228 @@ bool LinarADC::triggerLed (const bool status){
     }
 }
 
-void LinarADC::deleteFile(fs::FS &fs, const char *path) {
-    if (fs.remove(path)) {
-        debugfcn(formatMessage("- File '%s' deleted\r\n", path));
+void LinarADC::deleteFile(LinarStorage &store, const char *path) {
+    if (store.remove(path)) {
+        LINAR_LOGD("- File '%s' deleted\r\n", path);
     } else {
-        debugfcn(formatMessage("- Failed to delete file '%s'\r\n", path));
+        LINAR_LOGE("- Failed to delete file '%s'\r\n", path);
     }
 }
 
-bool LinarADC::spiffsRun(){
-    if (!SPIFFS.begin(true)) {
-        debugfcn(formatMessage("SPIFFS Mount Failed\r\n"));
+bool LinarADC::setResolution(uint8_t bits){
+    if (bits < 9 || bits > 12) {
+        LINAR_LOGE("- Unsupported resolution %u bits\r\n", bits);
+        return false;
+    }
+    if (bits == resolution) return true;
+
+    // Tables of the old size mean nothing at the new one
+    releaseMapping();
+    releaseLazy();
+    delete[] calibrationArray;
+    calibrationArray = nullptr;
+    delete[] results;
+    results = nullptr;
+    delete[] temperatureTables;
+    temperatureTables = nullptr;
+    temperatureCount = 0;
+    activeTemperature = INT32_MIN;
+    lut = nullptr;
+    useCalibration = false;
+
+    resolution = bits;
+    lutSize = 1 << bits;
+    sweepStride = lutSize / 256;
+
+    delete[] millivoltArray;
+    millivoltArray = new uint16_t[lutSize];
+    if (millivoltArray == nullptr) {
+        LINAR_LOGE("Memory allocation failed for millivolt array!\r\n");
         ledIndication(led2Pin, true);
         return false;
     }
+    memset(millivoltArray, 0, sizeof(uint16_t) * lutSize);
     return true;
 }
 
-bool LinarADC::openFile(){
-    if (fileType == ".txt") {
-        return readIntArrayFromTxt(SPIFFS, fullPath.c_str(), calibrationArray, 4096);
-    } else if (fileType == ".json") {
-        return readIntArrayFromJson(SPIFFS, fullPath.c_str(), calibrationArray, 4096);
-    } else if (fileType == ".bin") {
-        return readIntArrayFromBin(SPIFFS, fullPath.c_str(), calibrationArray, 4096);
-    } else {
-        debugfcn(formatMessage("- Unsupported file type\r\n"));
+bool LinarADC::storageRun(){
+    if (!storage->begin()) {
+        LINAR_LOGE("Storage Mount Failed\r\n");
+        ledIndication(led2Pin, true);
         return false;
     }
+    return true;
 }
 
-bool LinarADC::saveFile(){
-    deleteFile(SPIFFS, fullPath.c_str());
-
-    if (fileType == ".txt") {
-        return writeFloatAsIntToTxt(SPIFFS, fullPath.c_str(), results, 4097);
-    } else if (fileType == ".bin") {
-        return writeFloatAsIntToBin(SPIFFS, fullPath.c_str(), results, 4097);
-    } else if (fileType == ".json") {
-        return writeFloatAsIntToJson(SPIFFS, fullPath.c_str(), results, 4097);
-    } else {
-        debugfcn(formatMessage("- Unsupported file type\r\n"));
+bool LinarADC::openFile(){
+    // Decoded apart from the table in use, which is only replaced once every check passed
+    int *loaded = new int[lutSize];
+    if (loaded == nullptr) {
+        LINAR_LOGE("Memory allocation failed for calibration array!\r\n");
         ledIndication(led2Pin, true);
+        loadError = LinarLoadError::NoMemory;
         return false;
     }
+
+    // .bin is checked block by block while it streams in, the others once decoded
+    loadStarted = micros();
+    switch (format) {
+        case TxtFile:   loadError = readIntArrayFromTxt(*storage, fullPath.c_str(), loaded, lutSize); break;
+        case JsonFile:  loadError = readIntArrayFromJson(*storage, fullPath.c_str(), loaded, lutSize); break;
+        case BinFile:   loadError = readIntArrayFromBin(*storage, fullPath.c_str(), loaded, lutSize); break;
+        case DeltaFile: loadError = readIntArrayFromDelta(*storage, fullPath.c_str(), loaded, lutSize); break;
+        case PointsFile: loadError = readIntArrayFromPoints(*storage, fullPath.c_str(), loaded, lutSize); break;
+        default:        loadError = LinarLoadError::Unsupported; break;
+    }
+    if (loadError == LinarLoadError::None && format != BinFile && !checkTable(loaded)) {
+        loadError = LinarLoadError::Invalid;
+    }
+
+    if (loadError != LinarLoadError::None) {
+        LINAR_LOGE("- Calibration file not loaded: %s\r\n", errorName(loadError));
+        delete[] loaded;
+        return false;
+    }
+    releaseMapping();
+    releaseLazy();
+    delete[] calibrationArray;
+    calibrationArray = loaded;
+    lut = calibrationArray;
+    return true;
 }
 
-bool LinarADC::writeFloatAsIntToTxt(fs::FS &fs, const char *path, float *array, size_t size) {
-    File file = fs.open(path, FILE_WRITE);
-    if (!file) {
-        debugfcn(formatMessage("- Failed to open file for writing\r\n"));
+bool LinarADC::mapFile(){
+    if (format != BinFile) return false;
+
+    size_t length = 0;
+    const uint8_t *data = storage->map(fullPath.c_str(), length);
+    if (data == nullptr) return false;
+
+    const int *table = reinterpret_cast<const int *>(data);
+    uint32_t crc;
+    if (length < sizeof(int) * lutSize || !checkTable(table) ||
+        (storage->checksum(fullPath.c_str(), crc) && linarCrc32(data, length) != crc)) {
+        LINAR_LOGE("- Mapped calibration table is invalid\r\n");
+        loadError = LinarLoadError::Invalid;
+        storage->unmap(data);
         return false;
     }
-    for (size_t i = 0; i < size; i++) {
-        int intValue = static_cast<int>(array[i]);
-        file.print(intValue);      
-        if (i < size - 1) file.print(",");
-        file.flush();
+
+    // read() now indexes the mapped flash, the heap copy is not needed
+    delete[] calibrationArray;
+    calibrationArray = nullptr;
+    mappedTable = table;
+    lut = table;
+    LINAR_LOGI("- Calibration table mapped from storage, no heap copy\r\n");
+    return true;
+}
+
+void LinarADC::releaseMapping(){
+    if (mappedTable == nullptr) return;
+    if (lut == mappedTable) lut = nullptr;
+    storage->unmap(reinterpret_cast<const uint8_t *>(mappedTable));
+    mappedTable = nullptr;
+}
+
+bool LinarADC::makeTableWritable(){
+    if (calibrationArray == nullptr) {
+        calibrationArray = new int[lutSize];
+        if (calibrationArray == nullptr) {
+            LINAR_LOGE("Memory allocation failed for calibration array!\r\n");
+            ledIndication(led2Pin, true);
+            return false;
+        }
+        if (lut != nullptr) {
+            memcpy(calibrationArray, lut, sizeof(int) * lutSize);
+        } else if (lazyPoints != nullptr) {
+            invertTable(LazyCurve{*this}, calibrationArray);
+        } else {
+            memset(calibrationArray, 0, sizeof(int) * lutSize);
+        }
+    }
+    releaseMapping();
+    releaseLazy();
+    lut = calibrationArray;
+    return true;
+}
+
+bool LinarADC::checkNearlyMonotonic(const int *table, size_t first, size_t last, size_t origin){
+    for (size_t i = first; i <= last; i++) {
+        bool dropped = i > 0 && table[i] < table[i - 1] - sweepStride;   // more than one DAC step
+        if (table[i] < 0 || table[i] >= lutSize || dropped) {
+            LINAR_LOGE("- Invalid table value %d at index %u\r\n", table[i], (unsigned)(origin + i));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LinarADC::checkTable(const int *table){
+    for (size_t first = 0; first < (size_t)lutSize; first += loadBlock) {
+        if (!checkNearlyMonotonic(table, first, min(first + loadBlock, (size_t)lutSize) - 1)) return false;
+    }
+    if (table[lutSize - 1] - table[0] < lutSize / 2) {
+        LINAR_LOGE("- Table spans only %d codes\r\n", table[lutSize - 1] - table[0]);
+        return false;
     }
-    file.close();
-    debugfcn(formatMessage("- Float array saved as .txt\r\n"));
     return true;
 }
 
-bool LinarADC::writeFloatAsIntToBin(fs::FS &fs, const char *path, float *array, size_t size) {
-    File file = fs.open(path, FILE_WRITE);
-    if (!file) {
-        debugfcn(formatMessage("- Failed to open file for writing\r\n"));
+LinarADC::FileFormat LinarADC::formatOf(const String &type){
+    if (type == ".txt") return TxtFile;
+    if (type == ".json") return JsonFile;
+    if (type == ".bin") return BinFile;
+    if (type == ".delta") return DeltaFile;
+    if (type == ".points") return PointsFile;
+    return UnknownFile;
+}
+
+bool LinarADC::saveFile(){
+    switch (format) {
+        case TxtFile:   return writeFloatAsIntToTxt(*storage, fullPath.c_str(), results, lutSize + 1);
+        case BinFile:   return writeFloatAsIntToBin(*storage, fullPath.c_str(), results, lutSize + 1);
+        case JsonFile:  return writeFloatAsIntToJson(*storage, fullPath.c_str(), results, lutSize + 1);
+        case DeltaFile: return writeFloatAsIntToDelta(*storage, fullPath.c_str(), results, lutSize + 1);
+        case PointsFile: return writePoints(*storage, fullPath.c_str(), measuredPoints, 256);
+        default:
+            LINAR_LOGE("- Unsupported file type\r\n");
+            ledIndication(led2Pin, true);
+            return false;
+    }
+}
+
+bool LinarADC::writeFloatAsIntToTxt(LinarStorage &store, const char *path, float *array, size_t size) {
+    LinarBuffer buffer;
+    for (size_t i = 0; i < size; i++) {
+        int intValue = static_cast<int>(array[i]);
+        buffer.print(intValue);      
+        if (i < size - 1) buffer.print(",");
+    }
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
         return false;
     }
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Float array saved as .txt\r\n");
+    return true;
+}
+
+bool LinarADC::writeFloatAsIntToBin(LinarStorage &store, const char *path, float *array, size_t size) {
+    LinarBuffer buffer;
     for (size_t i = 0; i < size; i++) {
         int converted = static_cast<int>(array[i]);
-        file.write(reinterpret_cast<uint8_t *>(&converted), sizeof(int));
-        file.flush();
+        buffer.write(reinterpret_cast<uint8_t *>(&converted), sizeof(int));
+    }
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
+        return false;
     }
-    file.close();
-    debugfcn(formatMessage("- Float array saved as .bin\r\n"));
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Float array saved as .bin\r\n");
     return true;
 }
 
-bool LinarADC::writeFloatAsIntToJson(fs::FS &fs, const char *path, float *array, size_t size) {
+bool LinarADC::writeFloatAsIntToJson(LinarStorage &store, const char *path, float *array, size_t size) {
     JsonDocument jsonCalibrationResults;
 
     JsonArray jsonArray = jsonCalibrationResults[fileName].to<JsonArray>();
@@ -117,280 +274,1269 @@ bool LinarADC::writeFloatAsIntToJson(fs::FS &fs, const char *path, float *array,
         jsonArray.add(static_cast<int>(array[i]));
     }
 
-    File file = fs.open(path, FILE_WRITE);
-    if (!file) {
-        debugfcn(formatMessage("- Failed to open file for writing\r\n"));
-        file.close();
+    LinarBuffer buffer;
+    serializeJson(jsonCalibrationResults, buffer);
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
         return false;
     }
-    serializeJson(jsonCalibrationResults, file);
-    
-    file.close();
-    debugfcn(formatMessage("- Float array saved as .json\r\n"));
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Float array saved as .json\r\n");
     return true;
 }
 
-bool LinarADC::readIntArrayFromJson(fs::FS &fs, const char *path, int *array, size_t size) {
-    debugfcn(formatMessage("Reading JSON file and converting data to int array: %s\r\n", path));
+bool LinarADC::writeFloatAsIntToDelta(LinarStorage &store, const char *path, float *array, size_t size) {
+    LinarBuffer buffer;
+    LinarDeltaEncoder encoder(buffer, size);
+    for (size_t i = 0; i < size; i++) {
+        encoder.add(static_cast<int>(array[i]));
+    }
+    encoder.finish();
 
-    File file = fs.open(path, FILE_READ);
-    if (!file) {
-        debugfcn(formatMessage("- failed to open file for reading\r\n"));
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
         return false;
     }
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Float array saved as .delta (%u bytes)\r\n", (unsigned)buffer.length());
+    return true;
+}
 
-    JsonDocument jsonCalibrationResults;
+const char *LinarADC::errorName(LinarLoadError error) {
+    switch (error) {
+        case LinarLoadError::None:        return "none";
+        case LinarLoadError::NotFound:    return "not found";
+        case LinarLoadError::ShortRead:   return "short read";
+        case LinarLoadError::ParseError:  return "parse error";
+        case LinarLoadError::Overflow:    return "overflow";
+        case LinarLoadError::Timeout:     return "timeout";
+        case LinarLoadError::Invalid:     return "invalid table";
+        case LinarLoadError::NoMemory:    return "out of memory";
+        case LinarLoadError::Unsupported: return "unsupported file type";
+    }
+    return "unknown";
+}
+
+bool LinarADC::loadTimedOut() {
+    return micros() - loadStarted > maxLoadMicros;
+}
 
-    DeserializationError error = deserializeJson(jsonCalibrationResults, file);
-    if (error) {
-        debugfcn(formatMessage("- failed to parse JSON file: %s\r\n", error.c_str()));
-        file.close();
+bool LinarADC::storedCrcMatches(LinarStorage &store, const char *path, size_t offset, uint32_t crc) {
+    uint32_t expected;
+    if (!store.checksum(path, expected)) return true;
+
+    // Bytes the reader did not need still count towards the CRC
+    uint8_t tail[64];
+    size_t length = store.size(path);
+    while (offset < length) {
+        size_t bytes = min(sizeof(tail), length - offset);
+        if (store.read(path, offset, tail, bytes) != bytes) return false;
+        crc = linarCrc32(tail, bytes, crc);
+        offset += bytes;
+    }
+    if (crc != expected) {
+        LINAR_LOGE("- CRC mismatch in %s\r\n", path);
         return false;
     }
+    return true;
+}
+
+char *LinarADC::readBlob(LinarStorage &store, const char *path, size_t &length, LinarLoadError &error) {
+    ReadScope scope(store, path);
+
+    // A blob that fails the storage's CRC is dropped for an older version, if any
+    for (;;) {
+        length = store.size(path);
+        if (length == 0) {
+            error = LinarLoadError::NotFound;
+            return nullptr;
+        }
+
+        char *data = new char[length + 1];
+        if (data == nullptr) {
+            error = LinarLoadError::NoMemory;
+            return nullptr;
+        }
+
+        uint32_t crc = 0;
+        error = LinarLoadError::None;
+        for (size_t offset = 0; offset < length && error == LinarLoadError::None; offset += readChunk) {
+            size_t bytes = min(readChunk, length - offset);
+            error = loadTimedOut() ? LinarLoadError::Timeout
+                  : store.read(path, offset, (uint8_t *)data + offset, bytes) != bytes ? LinarLoadError::ShortRead
+                  : LinarLoadError::None;
+            if (error == LinarLoadError::None) crc = linarCrc32((const uint8_t *)data + offset, bytes, crc);
+        }
+        if (error == LinarLoadError::None && storedCrcMatches(store, path, length, crc)) {
+            data[length] = '\0';
+            return data;
+        }
+        delete[] data;
+
+        // A backend that checks whole reads itself may have fallen back to another version already
+        if (error == LinarLoadError::ShortRead && store.size(path) != length) continue;
+
+        // Otherwise whole blocks are never retried: a short read or a stalled backend ends the load
+        if (error != LinarLoadError::None) return nullptr;
+        error = LinarLoadError::Invalid;
+        if (!store.reject(path)) return nullptr;
+    }
+}
+
+LinarLoadError LinarADC::readIntArrayFromJson(LinarStorage &store, const char *path, int *array, size_t size) {
+    LINAR_LOGD("Reading JSON file and converting data to int array: %s\r\n", path);
+
+    size_t length;
+    LinarLoadError error;
+    char *data = readBlob(store, path, length, error);
+    if (data == nullptr) return error;
+
+    JsonDocument jsonCalibrationResults;
+
+    DeserializationError parseError = deserializeJson(jsonCalibrationResults, data, length);
+    delete[] data;
+    if (parseError) {
+        LINAR_LOGE("- failed to parse JSON file: %s\r\n", parseError.c_str());
+        return LinarLoadError::ParseError;
+    }
 
     JsonArray jsonArray = jsonCalibrationResults[fileName].as<JsonArray>();
+    if (jsonArray.isNull()) return LinarLoadError::ParseError;
 
     size_t index = 0;
-
     for (JsonVariant jsonValue : jsonArray) {
-        value = jsonValue.as<int>();
-        attempts = 0;
-        if (index < size) {
-            while (array[index] != value) {
-                array[index] = value; 
-                attempts++;
-                if (attempts >= maxAttempts) {
-                    debugfcn(formatMessage("- failed to read int at index %d after multiple attempts\r\n", index));
-                    file.close();
-                    return false;
-                }
-            }
-            array[index++];
-        } else {
-            debugfcn(formatMessage("- array size exceeded, some values were not read\r\n"));
-        break;
-        }
+        if (index > size) return LinarLoadError::Overflow;
+        if (!jsonValue.is<int>()) return LinarLoadError::ParseError;
+        if (index % loadBlock == 0 && loadTimedOut()) return LinarLoadError::Timeout;
+        if (index < size) array[index] = jsonValue.as<int>();   // the saved end point is skipped
+        index++;
     }
+    if (index < size) return LinarLoadError::ShortRead;
 
-    file.close();
-    debugfcn(formatMessage("- JSON file successfully read and data saved to int array\r\n"));
-    return true;
+    LINAR_LOGD("- JSON file successfully read and data saved to int array\r\n");
+    return LinarLoadError::None;
 }
 
-bool LinarADC::readIntArrayFromBin(fs::FS &fs, const char *path, int *array, size_t maxSize) {
-    debugfcn(formatMessage("Reading int array from binary file: %s\r\n", path));
+LinarLoadError LinarADC::readIntArrayFromBin(LinarStorage &store, const char *path, int *array, size_t maxSize) {
+    LINAR_LOGD("Reading int array from binary file: %s\r\n", path);
+    ReadScope scope(store, path);
 
-    File file = fs.open(path, FILE_READ);
-    if (!file || file.isDirectory()) {
-        debugfcn(formatMessage("- failed to open file for reading\r\n"));
-        return false;
+    // Header check first: the whole table must be there before any of it is read
+    size_t length = store.size(path);
+    if (length == 0) return LinarLoadError::NotFound;
+    if (length < maxSize * sizeof(int)) {
+        LINAR_LOGE("- file is too short (%u bytes)\r\n", (unsigned)length);
+        return LinarLoadError::ShortRead;
     }
 
-    for (size_t index = 0; index < maxSize && file.available(); ++index) {
-        value = 0;
-        size_t bytesRead = 0;
-        attempts = 0;
-
-        while (bytesRead != sizeof(int)) {
-            bytesRead = file.read((uint8_t *)&value, sizeof(int));
-            attempts++;
+    // Stream into the caller's buffer, validating each block and feeding the CRC
+    uint32_t crc = 0;
+    for (size_t first = 0; first < maxSize; first += loadBlock) {
+        size_t bytes = min(loadBlock, maxSize - first) * sizeof(int);
+        uint8_t *block = reinterpret_cast<uint8_t *>(&array[first]);
+        if (loadTimedOut()) return LinarLoadError::Timeout;
+        if (store.read(path, first * sizeof(int), block, bytes) != bytes) {
+            LINAR_LOGE("- failed to read block at index %u\r\n", (unsigned)first);
+            return LinarLoadError::ShortRead;
         }
-        while (array[index] != value) {
-            array[index] = value;
-            attempts++;
-        }               
-        if (attempts >= maxAttempts) {
-            debugfcn(formatMessage("- failed to read int at index %d after multiple attempts\r\n", index));
-            file.close();
-            return false;
-        }     
+        if (!checkNearlyMonotonic(array, first, first + bytes / sizeof(int) - 1)) return LinarLoadError::Invalid;
+        crc = linarCrc32(block, bytes, crc);
+    }
+    if (array[maxSize - 1] - array[0] < lutSize / 2) {
+        LINAR_LOGE("- Table spans only %d codes\r\n", array[maxSize - 1] - array[0]);
+        return LinarLoadError::Invalid;
     }
 
-    file.close();
-    debugfcn(formatMessage("- int array read from binary file one by one using for\r\n"));
-    return true;
-}   
+    // Trailing entries beyond the table only count towards the CRC
+    if (!storedCrcMatches(store, path, maxSize * sizeof(int), crc)) return LinarLoadError::Invalid;
+
+    LINAR_LOGD("- int array read from binary file\r\n");
+    return LinarLoadError::None;
+}
 
-bool LinarADC::readIntArrayFromTxt(fs::FS &fs, const char *path, int *array, size_t maxSize) {
-    debugfcn(formatMessage("Reading int array from a .txt file: %s\r\n", path));
+LinarLoadError LinarADC::readIntArrayFromDelta(LinarStorage &store, const char *path, int *array, size_t maxSize) {
+    LINAR_LOGD("Reading int array from a .delta file: %s\r\n", path);
 
-    File file = fs.open(path);
-    if (!file || file.isDirectory()) {
-        debugfcn(formatMessage("- failed to open file for reading\r\n"));
-        return false;
+    size_t length;
+    LinarLoadError error;
+    char *data = readBlob(store, path, length, error);
+    if (data == nullptr) return error;
+
+    bool decoded = linarDeltaDecode(reinterpret_cast<uint8_t *>(data), length, array, maxSize);
+    delete[] data;
+    if (!decoded) {
+        LINAR_LOGE("- invalid or truncated .delta file\r\n");
+        return LinarLoadError::ParseError;
     }
+    LINAR_LOGD("- int array read from a .delta file\r\n");
+    return LinarLoadError::None;
+}
 
-    String data = file.readString();  
-    file.close();
+LinarLoadError LinarADC::readIntArrayFromTxt(LinarStorage &store, const char *path, int *array, size_t maxSize) {
+    LINAR_LOGD("Reading int array from a .txt file: %s\r\n", path);
 
-    size_t index = 0;
+    size_t length;
+    LinarLoadError error;
+    char *data = readBlob(store, path, length, error);
+    if (data == nullptr) return error;
 
-    char *token = strtok((char *)data.c_str(), ",");
-    while (token != nullptr && index < maxSize) {
-        attempts = 0;
-        value = atoi(token); 
-        while (array[index] != value) {
-            array[index] = value; 
-            attempts++;
-        
-            if (attempts >= maxAttempts) {
-                debugfcn(formatMessage("- failed to read int at index %d after multiple attempts\r\n", index));
-                return false;
-            }
+    // Comma-separated integers; anything else is a parse error, not a retry
+    size_t index = 0;
+    char *cursor = data;
+    error = LinarLoadError::None;
+    while (*cursor != '\0' && error == LinarLoadError::None) {
+        char *end;
+        long parsed = strtol(cursor, &end, 10);
+        bool number = end != cursor;
+        while (isspace((unsigned char)*end)) end++;
+        if (!number || (*end != ',' && *end != '\0')) {
+            error = LinarLoadError::ParseError;
+        } else if (index > maxSize) {
+            error = LinarLoadError::Overflow;
+        } else if (index % loadBlock == 0 && loadTimedOut()) {
+            error = LinarLoadError::Timeout;
+        } else {
+            if (index < maxSize) array[index] = parsed;     // the saved end point is skipped
+            index++;
+            cursor = *end == ',' ? end + 1 : end;
         }
-        token = strtok(nullptr, ",");
-        index++;
     }
-    debugfcn(formatMessage("- int array read from a .txt file\r\n"));
+    delete[] data;
+
+    if (error == LinarLoadError::None && index < maxSize) error = LinarLoadError::ShortRead;
+    if (error != LinarLoadError::None) {
+        LINAR_LOGE("- .txt file rejected at value %u: %s\r\n", (unsigned)index, errorName(error));
+        return error;
+    }
+    LINAR_LOGD("- int array read from a .txt file\r\n");
+    return LinarLoadError::None;
+}
+
+bool LinarADC::allocateResults(){
+    if (results == nullptr) results = new float[lutSize + 1];
+    if (results == nullptr) {
+        LINAR_LOGE("Memory allocation failed for results array!\r\n");
+        ledIndication(led2Pin, true);
+        return false;
+    }
+    memset(results, 0, sizeof(float) * (lutSize + 1));
     return true;
 }
 
-void LinarADC::generateLut(){
-    debugfcn(formatMessage("Test Linearity "));
+void LinarADC::releaseResults(){
+    delete[] results;
+    results = nullptr;
+    delete[] measuredPoints;
+    measuredPoints = nullptr;
+}
+
+void LinarADC::sweep(LinarADC **channels, size_t count){
+    LinarADC &lead = *channels[0];
+    uint32_t settledAt[DAC_CHANNEL_MAX];
+    bool dacUsed[DAC_CHANNEL_MAX] = {};
+
+    for (size_t c = 0; c < count; c++) {
+        LinarADC &adc = *channels[c];
+        dacUsed[adc.dacCalib] = true;
+        if (adc.recordSweeps && adc.sweepRecord == nullptr) {
+            adc.sweepRecord = new LinarSweepPoint[CalibrationReport::points];
+            if (adc.sweepRecord == nullptr) LINAR_LOG_AT(adc, LinarLogLevel::Warning, "- Sweep not recorded, out of memory\r\n");
+        }
+        if (adc.sweepRecord != nullptr) memset(adc.sweepRecord, 0, sizeof(LinarSweepPoint) * CalibrationReport::points);
+    }
+    for (int d = 0; d < DAC_CHANNEL_MAX; d++) {
+        if (!dacUsed[d]) continue;
+        dac_output_voltage((dac_channel_t)d, 0);
+        settledAt[d] = micros() + settleMicros;
+    }
+
+    uint32_t startCycles = linarCycles();
+    uint32_t startMicros = micros();
+    LINAR_LOG_AT(lead, LinarLogLevel::Info, "Test Linearity ");
     for (int j = 0; j < 500; j++) {
         if (j % 100 == 0) {
-            debugfcn(formatMessage("."));
-            ledIndication(led1Pin, false);
+            LINAR_LOG_AT(lead, LinarLogLevel::Info, ".");
+            lead.ledIndication(lead.led1Pin, false);
         }
         for (int i = 0; i < 256; i++) {
-            dac_output_voltage(DAC_CHANNEL_1, (i & 0xff));
-            delayMicroseconds(100);
-            results[i * 16] = 0.9 * results[i * 16] + 0.1 * analogRead(adcPinCalib);
+            // Each DAC steps right after its channels are sampled, so it
+            // settles while the channels of the other DAC are read
+            for (int d = 0; d < DAC_CHANNEL_MAX; d++) {
+                if (!dacUsed[d]) continue;
+                while ((int32_t)(micros() - settledAt[d]) < 0) {}
+                for (size_t c = 0; c < count; c++) {
+                    LinarADC &adc = *channels[c];
+                    if (adc.dacCalib != d) continue;
+                    adc.selectResolution();
+                    float &point = adc.results[i * adc.sweepStride];
+                    int sample = analogRead(adc.adcPinCalib);
+                    point = 0.9 * point + 0.1 * sample;
+                    if (adc.sweepRecord != nullptr) adc.sweepRecord[i].add(sample);
+                }
+                dac_output_voltage((dac_channel_t)d, ((i + 1) & 0xff));
+                settledAt[d] = micros() + settleMicros;
+            }
+        }
+    }
+    LINAR_LOG_AT(lead, LinarLogLevel::Info, "\r\n");
+
+    // One sweep serves every channel, each is charged the full time
+    uint32_t cycles = linarCycles() - startCycles;
+    uint32_t elapsed = micros() - startMicros;
+    for (size_t c = 0; c < count; c++) {
+        channels[c]->stats.add(LinarPhase::Sweep, cycles, elapsed);
+        channels[c]->stats.samples += 500 * 256;
+    }
+
+    for (size_t c = 0; c < count; c++) {
+        LinarADC &adc = *channels[c];
+        if (adc.sweepRecord == nullptr) continue;
+        for (int i = 0; i < CalibrationReport::points; i++) {
+            adc.sweepRecord[i].finish(adc.results[i * adc.sweepStride]);
+        }
+        LinarPhaseTimer write(adc.stats, LinarPhase::Write);
+        adc.writeSweep(*adc.storage, adc.sweepPath.c_str());
+        delete[] adc.sweepRecord;
+        adc.sweepRecord = nullptr;
+    }
+}
+
+bool LinarADC::writeSweep(LinarStorage &store, const char *path) {
+    LinarBuffer buffer;
+    uint32_t magic = sweepMagic;
+    uint16_t points = CalibrationReport::points;
+    uint8_t bits = resolution;
+    uint8_t reserved = 0;
+    uint32_t crc = linarCrc32((const uint8_t *)sweepRecord, sizeof(LinarSweepPoint) * points);
+    buffer.write((uint8_t *)&magic, sizeof(magic));
+    buffer.write((uint8_t *)&points, sizeof(points));
+    buffer.write(&bits, sizeof(bits));
+    buffer.write(&reserved, sizeof(reserved));
+    buffer.write((uint8_t *)&crc, sizeof(crc));
+    buffer.write((uint8_t *)sweepRecord, sizeof(LinarSweepPoint) * points);
+
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
+        return false;
+    }
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Sweep recorded as %s\r\n", path);
+    return true;
+}
+
+bool LinarADC::readSweep(LinarStorage &store, const char *path, LinarSweepPoint *points, uint8_t &bits) {
+    LINAR_LOGD("Reading recorded sweep: %s\r\n", path);
+    ReadScope scope(store, path);
+
+    struct {
+        uint32_t magic;
+        uint16_t points;
+        uint8_t bits;
+        uint8_t reserved;
+        uint32_t crc;
+    } header;
+    size_t bytes = sizeof(LinarSweepPoint) * CalibrationReport::points;
+
+    // Both pieces are checked against the storage's CRC before the header is trusted
+    bool intact;
+    do {
+        if (store.read(path, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+            LINAR_LOGE("- no recorded sweep\r\n");
+            return false;
+        }
+        if (store.read(path, sizeof(header), (uint8_t *)points, bytes) != bytes) {
+            LINAR_LOGE("- sweep file is truncated\r\n");
+            return false;
         }
+        uint32_t crc = linarCrc32((const uint8_t *)&header, sizeof(header));
+        intact = storedCrcMatches(store, path, sizeof(header) + bytes, linarCrc32((const uint8_t *)points, bytes, crc));
+    } while (!intact && store.reject(path));
+    if (!intact) return false;
+
+    if (header.magic != sweepMagic || header.points != CalibrationReport::points ||
+        header.bits < 9 || header.bits > 12) {
+        LINAR_LOGE("- invalid sweep file header\r\n");
+        return false;
+    }
+    if (linarCrc32((const uint8_t *)points, bytes) != header.crc) {
+        LINAR_LOGE("- sweep file is corrupted\r\n");
+        return false;
+    }
+    bits = header.bits;
+    return true;
+}
+
+bool LinarADC::replaySweep(const char *path, bool useMean) {
+    if (path == nullptr) path = sweepPath.c_str();
+    if (!storageRun()) return false;
+
+    LinarSweepPoint *points = new LinarSweepPoint[CalibrationReport::points];
+    if (points == nullptr) {
+        LINAR_LOGE("Memory allocation failed for sweep points!\r\n");
+        return triggerLed(false);
+    }
+    uint8_t bits;
+    if (!readSweep(*storage, path, points, bits) || !allocateResults()) {
+        delete[] points;
+        return triggerLed(false);
+    }
+
+    // Codes recorded at another resolution are scaled to this one
+    float scale = (float)lutSize / (1 << bits);
+    for (int i = 0; i < CalibrationReport::points; i++) {
+        results[i * sweepStride] = (useMean ? points[i].mean : points[i].filtered) * scale;
+    }
+    delete[] points;
+
+    float *scratch = new float[lutSize + 1];
+    if (scratch == nullptr) {
+        LINAR_LOGE("Memory allocation failed for the curve!\r\n");
+        return triggerLed(false);
+    }
+    buildLut(scratch);
+    delete[] scratch;
+
+    bool built = makeTableWritable();
+    if (built) {
+        for (int i = 0; i < lutSize; i++) calibrationArray[i] = static_cast<int>(results[i]);
+        built = checkTable(calibrationArray);
+    }
+    delete[] results;
+    results = nullptr;
+    if (!built) {
+        LINAR_LOGE("- Replayed table is invalid\r\n");
+        return triggerLed(false);
     }
 
-    debugfcn(formatMessage("\r\n"));
-    debugfcn(formatMessage("Calculate interpolated values ..\r\n"));
-    results[4096] = 4095.0;
+    useCalibration = true;
+    buildMillivoltLut();
+    LINAR_LOGI("- Table rebuilt from %s\r\n", path);
+    return triggerLed(true);
+}
+
+void LinarADC::interpolateCurve(float *curve){
+    curve[lutSize] = lutSize - 1;
     for (int i = 0; i < 256; i++) {
-        for (int j = 1; j < 16; j++) {
-            results[i * 16 + j] = results[i * 16] + (results[(i + 1) * 16] - results[i * 16]) * (float)j / 16.0;
+        for (int j = 1; j < sweepStride; j++) {
+            curve[i * sweepStride + j] = curve[i * sweepStride] +
+                (curve[(i + 1) * sweepStride] - curve[i * sweepStride]) * (float)j / sweepStride;
         }
     }
 
-    debugfcn(formatMessage("Generating LUT ..\r\n"));
-    for (int i=0; i<4096; i++) {
-        results[i]=0.5 + results[i];
+    for (int i=0; i<lutSize; i++) {
+        curve[i]=0.5 + curve[i];
     }
+    curve[lutSize]=lutSize - 0.5;
+}
+
+void LinarADC::buildLut(float *curve){
+    LINAR_LOGI("Calculate interpolated values ..\r\n");
+    LinarPhaseTimer interpolate(stats, LinarPhase::Interpolate);
+    interpolateCurve(results);
+    memcpy(curve, results, sizeof(float) * (lutSize + 1));
+    interpolate.stop();
 
-    results[4096]=4095.5000;
-    for (int i=0; i<4096; i++) {
-        for (int j=0; j<5; j++) {
-            res2[i*5+j] = results[i] + (results[(i+1)] - results[i]) * (float)j / (float)10.0;
+    LINAR_LOGI("Generating LUT ..\r\n");
+    LinarPhaseTimer invert(stats, LinarPhase::Invert);
+    if (!invertTable(curve, results)) LINAR_LOGW("- Sweep is not monotonic, used the exhaustive search\r\n");
+}
+
+bool LinarADC::keepPoints(){
+    if (measuredPoints == nullptr) measuredPoints = new float[256];
+    if (measuredPoints == nullptr) {
+        LINAR_LOGE("Memory allocation failed for sweep points!\r\n");
+        return false;
+    }
+    for (int i = 0; i < 256; i++) measuredPoints[i] = results[i * sweepStride];
+    return true;
+}
+
+bool LinarADC::writePoints(LinarStorage &store, const char *path, float *points, size_t count) {
+    LinarBuffer buffer;
+    uint32_t magic = pointsMagic;
+    uint16_t stored = count;
+    uint8_t bits = resolution;
+    uint8_t reserved = 0;
+    uint32_t crc = linarCrc32((const uint8_t *)points, sizeof(float) * count);
+    buffer.write((uint8_t *)&magic, sizeof(magic));
+    buffer.write((uint8_t *)&stored, sizeof(stored));
+    buffer.write(&bits, sizeof(bits));
+    buffer.write(&reserved, sizeof(reserved));
+    buffer.write((uint8_t *)&crc, sizeof(crc));
+    buffer.write((uint8_t *)points, sizeof(float) * count);
+
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
+        return false;
+    }
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Sweep points saved as .points (%u bytes)\r\n", (unsigned)buffer.length());
+    return true;
+}
+
+LinarLoadError LinarADC::readPoints(LinarStorage &store, const char *path, float *points) {
+    ReadScope scope(store, path);
+    struct {
+        uint32_t magic;
+        uint16_t count;
+        uint8_t bits;
+        uint8_t reserved;
+        uint32_t crc;
+    } header;
+    size_t bytes = sizeof(float) * 256;
+
+    // Both pieces are checked against the storage's CRC before the header is trusted
+    bool intact;
+    do {
+        if (store.size(path) == 0) return LinarLoadError::NotFound;
+        if (store.read(path, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+            store.read(path, sizeof(header), (uint8_t *)points, bytes) != bytes) {
+            return LinarLoadError::ShortRead;
         }
+        uint32_t crc = linarCrc32((const uint8_t *)&header, sizeof(header));
+        intact = storedCrcMatches(store, path, sizeof(header) + bytes, linarCrc32((const uint8_t *)points, bytes, crc));
+    } while (!intact && store.reject(path));
+    if (!intact) return LinarLoadError::Invalid;
+
+    if (header.magic != pointsMagic || header.count != 256 || header.bits < 9 || header.bits > 12) {
+        LINAR_LOGE("- invalid .points file header\r\n");
+        return LinarLoadError::ParseError;
+    }
+    if (linarCrc32((const uint8_t *)points, bytes) != header.crc) {
+        LINAR_LOGE("- CRC mismatch in .points file\r\n");
+        return LinarLoadError::Invalid;
     }
 
-    for (int i=1; i<4096; i++) {
-        int index;
-        float minDiff=99999.0;
-        for (int j=0; j<(5*4096); j++) {
-            float diff=fabs((float)(i) - res2[j]);
-            if(diff<minDiff) {
-                minDiff=diff;
-                index=j;
-            }
+    // Points recorded at another resolution are scaled to this one
+    if (header.bits != resolution) {
+        float scale = (float)lutSize / (1 << header.bits);
+        for (int i = 0; i < 256; i++) points[i] *= scale;
+    }
+    return LinarLoadError::None;
+}
+
+LinarLoadError LinarADC::readIntArrayFromPoints(LinarStorage &store, const char *path, int *array, size_t size) {
+    LINAR_LOGD("Building the table from sweep points: %s\r\n", path);
+
+    float *curve = new float[lutSize + 1];
+    if (curve == nullptr) return LinarLoadError::NoMemory;
+
+    // The points go to the front, then out to their stride positions, back to front
+    LinarLoadError error = readPoints(store, path, curve);
+    if (error == LinarLoadError::None && loadTimedOut()) error = LinarLoadError::Timeout;
+    if (error != LinarLoadError::None) {
+        delete[] curve;
+        return error;
+    }
+    for (int i = 255; i >= 0; i--) curve[i * sweepStride] = curve[i];
+
+    interpolateCurve(curve);
+    invertTable(curve, array);
+    delete[] curve;
+
+    LINAR_LOGD("- table built from sweep points\r\n");
+    return LinarLoadError::None;
+}
+
+float LinarADC::lazyCurveAt(int x) const{
+    // Same operations as interpolateCurve(), so the segments match a full build bit for bit
+    if (x >= lutSize) return lutSize - 0.5;
+    int i = x / sweepStride;
+    int j = x % sweepStride;
+    float start = lazyPoints[i];
+    float end = i < 255 ? lazyPoints[i + 1] : (float)(lutSize - 1);
+    float value = j == 0 ? start : start + (end - start) * (float)j / sweepStride;
+    return 0.5 + value;
+}
+
+int LinarADC::buildSegment(int raw) const{
+    uint16_t *segment = new uint16_t[segmentSize];
+    if (segment == nullptr) {
+        loadError = LinarLoadError::NoMemory;
+        return formula(raw);            // retried on the next read
+    }
+
+    int first = raw - raw % segmentSize;
+    LazyCurve curve = {*this};
+    if (first == 0) {
+        segment[0] = 0;                 // always noise
+        invertCurve(curve, segment + 1, 1, segmentSize, lazyAscending);
+    } else {
+        invertCurve(curve, segment, first, first + segmentSize, lazyAscending);
+    }
+    segments[raw / segmentSize] = segment;
+    segmentsBuilt++;
+    return segment[raw % segmentSize];
+}
+
+bool LinarADC::openLazy(){
+    releaseLazy();
+    lazyPoints = new float[256];
+    if (lazyPoints == nullptr) {
+        loadError = LinarLoadError::NoMemory;
+        return false;
+    }
+
+    loadStarted = micros();
+    loadError = readPoints(*storage, fullPath.c_str(), lazyPoints);
+    if (loadError != LinarLoadError::None) {
+        LINAR_LOGE("- Calibration file not loaded: %s\r\n", errorName(loadError));
+        releaseLazy();
+        return false;
+    }
+
+    // Check every entry the segments will hold, as checkTable() would, one segment at a time
+    LazyCurve curve = {*this};
+    lazyAscending = curveAscending(curve);
+    int block[segmentSize + 1];         // the previous segment's last entry, then this segment
+    block[segmentSize] = 0;
+    bool valid = true;
+    for (int first = 0; first < lutSize && valid; first += segmentSize) {
+        block[0] = block[segmentSize];
+        if (first == 0) {
+            block[1] = 0;               // always noise
+            invertCurve(curve, block + 2, 1, segmentSize, lazyAscending);
+        } else {
+            invertCurve(curve, block + 1, first, first + segmentSize, lazyAscending);
         }
-        results[i]=(float)index;
+        valid = checkNearlyMonotonic(block, 1, segmentSize, first - 1);
+    }
+    if (valid && block[segmentSize] < lutSize / 2) {
+        LINAR_LOGE("- Table spans only %d codes\r\n", block[segmentSize]);
+        valid = false;
+    }
+    if (!valid) {
+        loadError = LinarLoadError::Invalid;
+        releaseLazy();
+        return false;
     }
 
-    for (int i=0; i<(4096); i++) {
-        results[i]/=5;
+    // Nothing else holds a table now
+    releaseMapping();
+    delete[] calibrationArray;
+    calibrationArray = nullptr;
+    lut = nullptr;
+    return true;
+}
+
+void LinarADC::releaseLazy(){
+    for (int i = 0; i < 4096 / segmentSize; i++) {
+        delete[] segments[i];
+        segments[i] = nullptr;
     }
+    segmentsBuilt = 0;
+    delete[] lazyPoints;
+    lazyPoints = nullptr;
+}
 
-    results[0] = 0;                    // always noise 
-    delete[] res2;
-    res2 = nullptr;
+size_t LinarADC::getTableBytes() const{
+    if (lazyPoints != nullptr) return sizeof(float) * 256 + segmentsBuilt * sizeof(uint16_t) * segmentSize;
+    return calibrationArray != nullptr ? sizeof(int) * lutSize : 0;
+}
+
+bool LinarADC::generateLut(){
+    LinarADC *self = this;
+    if (!allocateResults()) return false;
+    sweep(&self, 1);
+
+    float *curve = new float[lutSize + 1];
+    if (curve == nullptr) {
+        LINAR_LOGE("Memory allocation failed for the curve!\r\n");
+        ledIndication(led2Pin, true);
+        return false;
+    }
+    buildLut(curve);
+    delete[] curve;
+    return true;
 }
 
 bool LinarADC::calibration(){
-    float mseCalibrated;
-    float mseRaw;
     int rawReading;
+    int previous = 0;
+    float mseCalibrated = 0;
+    float mseRaw = 0;
 
-    debugfcn(formatMessage("Testing the file..\r\n"));
+    LINAR_LOGI("Testing the file..\r\n");
 
     if (!triggerLed(openFile())) return false;
 
     printLUT(calibrationArray);
 
+    memset(&report, 0, sizeof(report));
+    selectResolution();
+    const int codeRange = lutSize - 8 * sweepStride;   // span of the DAC steps tested
+
+    // Single pass over the DAC steps: every metric is updated in place
     for (int i=1; i<250; i++) {
-        dac_output_voltage(DAC_CHANNEL_1, i); 
-        delayMicroseconds(100);
+        dac_output_voltage(dacCalib, i); 
+        delayMicroseconds(settleMicros);
         rawReading = analogRead(adcPinCalib);
-        mseRaw += (i*16 - rawReading) * (i*16 - rawReading);
-        mseCalibrated += (i*16 - calibrationArray[rawReading]) * (i*16 - calibrationArray[rawReading]);     
+
+        int calibrated = calibrationArray[rawReading];
+        int inl = calibrated - i * sweepStride;
+        int dnl = (i == 1) ? 0 : calibrated - previous - sweepStride;
+        previous = calibrated;
+
+        report.inl[i] = inl;
+        report.dnl[i] = dnl;
+        if (abs(inl) > abs(report.maxInl)) report.maxInl = inl;
+        if (abs(dnl) > abs(report.maxDnl)) report.maxDnl = dnl;
+
+        int bin = (inl + CalibrationReport::histogramSpan) * CalibrationReport::histogramBins /
+                  (2 * CalibrationReport::histogramSpan);
+        report.histogram[constrain(bin, 0, CalibrationReport::histogramBins - 1)]++;
+
+        mseRaw += (i*sweepStride - rawReading) * (i*sweepStride - rawReading);
+        mseCalibrated += inl * inl;
+        report.pointCount++;
+    }
+
+    // Output codes the table can never produce
+    for (int i = 1; i < lutSize; i++) {
+        int gap = calibrationArray[i] - calibrationArray[i - 1] - 1;
+        if (gap > 0) report.missingCodes += gap;
     }
 
-    mseCalibrated = ((sqrt(mseCalibrated / 249) / 3968) * 100);
-    mseRaw = ((sqrt(mseRaw / 249) / 3968) * 100);
+    report.rmsCalibrated = ((sqrt(mseCalibrated / report.pointCount) / codeRange) * 100);
+    report.rmsRaw = ((sqrt(mseRaw / report.pointCount) / codeRange) * 100);
+    report.passed = report.rmsCalibrated <= 1;
+
+    LINAR_LOGI("Max INL %d LSB, max DNL %d LSB, %d missing codes\r\n",
+                           report.maxInl, report.maxDnl, report.missingCodes);
+    writeReportToJson(*storage, reportPath.c_str());
 
-    if ( mseCalibrated > 1){       //  3968 array data range (maxValue-minValue)
-        debugfcn(formatMessage("Calibration error!\r\n"));
-        debugfcn(formatMessage("Mean squared value error is more than 1 %\r\n"));
-        deleteFile(SPIFFS, fullPath.c_str());
+    if (!report.passed){       //  codeRange array data range (maxValue-minValue)
+        LINAR_LOGE("Calibration error!\r\n");
+        LINAR_LOGE("Mean squared value error is more than 1 %%\r\n");
+        // Drop the new table; with slots the previous calibration is current again
+        if (!storage->reject(fullPath.c_str())) deleteFile(*storage, fullPath.c_str());
         return false;
     }
     
     else{
-        debugfcn(formatMessage("Uncalibrated mean squared error: '%f' % \r\n", mseRaw ));     //  3968 array data range (maxValue-minValue)
-        debugfcn(formatMessage("Calibrated mean squared error: '%f' % \r\n", mseCalibrated));
+        LINAR_LOGI("Uncalibrated mean squared error: '%f' %% \r\n", report.rmsRaw);     //  codeRange array data range (maxValue-minValue)
+        LINAR_LOGI("Calibrated mean squared error: '%f' %% \r\n", report.rmsCalibrated);
         ledIndication(led1Pin, true);
         return true;
     }
 }
 
-bool LinarADC::save(dac_channel_t dacChannel = DAC_CHANNEL_1) {
+bool LinarADC::writeReportToJson(LinarStorage &store, const char *path) {
+    JsonDocument jsonReport;
+
+    jsonReport["file"] = fullPath.c_str();
+    jsonReport["passed"] = report.passed;
+    jsonReport["points"] = report.pointCount;
+    jsonReport["rmsRaw"] = report.rmsRaw;
+    jsonReport["rmsCalibrated"] = report.rmsCalibrated;
+    jsonReport["maxInl"] = report.maxInl;
+    jsonReport["maxDnl"] = report.maxDnl;
+    jsonReport["missingCodes"] = report.missingCodes;
+
+    JsonArray histogram = jsonReport["histogram"].to<JsonArray>();
+    for (int i = 0; i < CalibrationReport::histogramBins; i++) histogram.add(report.histogram[i]);
+
+    JsonArray inl = jsonReport["inl"].to<JsonArray>();
+    JsonArray dnl = jsonReport["dnl"].to<JsonArray>();
+    for (int i = 0; i < CalibrationReport::points; i++) {
+        inl.add(report.inl[i]);
+        dnl.add(report.dnl[i]);
+    }
+
+    LinarBuffer buffer;
+    serializeJson(jsonReport, buffer);
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
+        return false;
+    }
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- Calibration report saved as %s\r\n", path);
+    return true;
+}
+
+bool LinarADC::save(dac_channel_t dacChannel) {
+    LinarADC *self = this;
+    return saveBatch(&self, &dacChannel, 1);
+}
+
+bool LinarADC::saveBatch(LinarADC **channels, const dac_channel_t *dacChannels, size_t count, uint32_t *cycleTimeMs) {
+    if (count == 0) return false;
+    LinarADC &lead = *channels[0];
+    uint32_t start = millis();
+    int largest = 0;
+
+    //setup
+    for (size_t c = 0; c < count; c++) {
+        channels[c]->dacCalib = dacChannels[c];
+        dac_output_enable(dacChannels[c]);
+        dac_output_voltage(dacChannels[c], 0);
+        channels[c]->stats.reset();
+        if (!channels[c]->allocateResults()) {
+            for (size_t r = 0; r < c; r++) channels[r]->releaseResults();
+            return false;
+        }
+        largest = max(largest, channels[c]->lutSize);
+    }
+    delay(1000);
+    for (size_t c = 0; c < count; c++) {
+        if (channels[c]->storageRun()) continue;     // shared storages mount only once
+        for (size_t r = 0; r < count; r++) channels[r]->releaseResults();
+        return false;
+    }
+
+    //acquire every channel in one sweep
+    sweep(channels, count);
+
+    // One scratch arena for the LUT generation of all channels
+    float *scratch = new float[largest + 1];
+    if (scratch == nullptr) {
+        LINAR_LOG_AT(lead, LinarLogLevel::Error, "Memory allocation failed for the curve!\r\n");
+        lead.ledIndication(lead.led2Pin, true);
+        for (size_t c = 0; c < count; c++) channels[c]->releaseResults();
+        return false;
+    }
+
+    //generate calibration values, save and verify channel by channel
+    size_t passed = 0;
+    for (size_t c = 0; c < count; c++) {
+        LinarADC &adc = *channels[c];
+        bool kept = adc.format != PointsFile || adc.keepPoints();   // .points stores the sweep, not the table
+        adc.buildLut(scratch);
+        adc.printLUT(adc.results);
+
+        LinarPhaseTimer write(adc.stats, LinarPhase::Write);
+        bool saved = adc.triggerLed(kept && adc.saveFile());
+        write.stop();
+        adc.releaseResults();
+
+        LinarPhaseTimer verify(adc.stats, LinarPhase::Verify);
+        if (saved && adc.triggerLed(adc.calibration())) passed++;
+    }
+    delete[] scratch;
+
+    uint32_t elapsed = millis() - start;
+    if (cycleTimeMs != nullptr) *cycleTimeMs = elapsed;
+    LINAR_LOG_AT(lead, LinarLogLevel::Info, "Calibrated %u/%u channels in %lu ms\r\n",
+                                           (unsigned)passed, (unsigned)count, (unsigned long)elapsed);
+    for (size_t c = 0; c < count; c++) {
+        const LinarPhaseStats &stats = channels[c]->stats;
+        for (int p = 0; p < LinarPhaseStats::phaseCount; p++) {
+            LINAR_LOG_AT(*channels[c], LinarLogLevel::Debug, "- %s: %lu us, %lu cycles\r\n",
+                         LinarPhaseStats::phaseName((LinarPhase)p),
+                         (unsigned long)stats.micros[p], (unsigned long)stats.cycles[p]);
+        }
+    }
+    return passed == count;
+}
+
+bool LinarADC::readTemperatureTables(LinarStorage &store, const char *path) {
+    LINAR_LOGD("Reading temperature tables: %s\r\n", path);
+    ReadScope scope(store, path);
+
+    struct {
+        uint32_t magic;
+        uint16_t count;
+        uint16_t tableSize;
+    } header;
+    size_t bytes = sizeof(int16_t) * lutSize;
+
+    // Every piece feeds the CRC; a version that fails it is dropped for an older one
+    do {
+        if (store.read(path, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header)) {
+            LINAR_LOGD("- no temperature tables\r\n");
+            return false;
+        }
+        uint32_t crc = linarCrc32((const uint8_t *)&header, sizeof(header));
+        if (header.magic != temperatureMagic || header.count > maxTemperatureTables || header.tableSize != lutSize) {
+            if (!storedCrcMatches(store, path, sizeof(header), crc)) continue;
+            LINAR_LOGE("- invalid temperature file header\r\n");
+            return false;
+        }
+
+        int16_t *tables = new (std::nothrow) int16_t[header.count * lutSize];
+        if (tables == nullptr) {
+            LINAR_LOGE("Memory allocation failed for temperature tables!\r\n");
+            return false;
+        }
+        float captured[maxTemperatureTables];
+        size_t offset = sizeof(header);
+        for (int i = 0; i < header.count; i++) {
+            if (store.read(path, offset, (uint8_t *)&captured[i], sizeof(float)) != sizeof(float) ||
+                store.read(path, offset + sizeof(float), (uint8_t *)&tables[i * lutSize], bytes) != bytes) {
+                LINAR_LOGE("- temperature table %d is truncated\r\n", i);
+                delete[] tables;
+                return false;
+            }
+            crc = linarCrc32((const uint8_t *)&captured[i], sizeof(float), crc);
+            crc = linarCrc32((const uint8_t *)&tables[i * lutSize], bytes, crc);
+            offset += sizeof(float) + bytes;
+        }
+        if (!storedCrcMatches(store, path, offset, crc)) {
+            delete[] tables;
+            continue;
+        }
+
+        delete[] temperatureTables;
+        temperatureTables = tables;
+        temperatureCount = header.count;
+        memcpy(temperatures, captured, sizeof(float) * header.count);
+        activeTemperature = INT32_MIN;
+        LINAR_LOGI("- %d temperature tables loaded\r\n", header.count);
+        return true;
+    } while (store.reject(path));
+    return false;
+}
+
+bool LinarADC::writeTemperatureTables(LinarStorage &store, const char *path) {
+    LinarBuffer buffer;
+    uint32_t magic = temperatureMagic;
+    uint16_t count = temperatureCount;
+    uint16_t tableSize = lutSize;
+    buffer.write((uint8_t *)&magic, sizeof(magic));
+    buffer.write((uint8_t *)&count, sizeof(count));
+    buffer.write((uint8_t *)&tableSize, sizeof(tableSize));
+    for (int i = 0; i < temperatureCount; i++) {
+        buffer.write((uint8_t *)&temperatures[i], sizeof(float));
+        buffer.write((uint8_t *)&temperatureTables[i * lutSize], sizeof(int16_t) * lutSize);
+    }
+
+    if (!store.write(path, buffer.data(), buffer.length())) {
+        LINAR_LOGE("- Failed to open file for writing\r\n");
+        return false;
+    }
+    stats.bytesWritten += buffer.length();
+    LINAR_LOGI("- %d temperature tables saved\r\n", temperatureCount);
+    return true;
+}
+
+bool LinarADC::addTemperatureTable(float temperature, float *array) {
+    if (temperatureTables == nullptr) temperatureCount = 0;
+
+    // Replace a table captured at the same temperature, otherwise insert in order
+    int slot = 0;
+    while (slot < temperatureCount && temperatures[slot] < temperature - 0.5) slot++;
+    if (slot == temperatureCount || fabs(temperatures[slot] - temperature) > 0.5) {
+        if (temperatureCount == maxTemperatureTables) {
+            LINAR_LOGE("- temperature table limit reached\r\n");
+            return false;
+        }
+
+        // Only the tables in use are held, so grow by one with a gap at the slot
+        int16_t *tables = new (std::nothrow) int16_t[(temperatureCount + 1) * lutSize];
+        if (tables == nullptr) {
+            LINAR_LOGE("Memory allocation failed for temperature tables!\r\n");
+            return false;
+        }
+        if (temperatureTables != nullptr) {
+            memcpy(tables, temperatureTables, sizeof(int16_t) * lutSize * slot);
+            memcpy(&tables[(slot + 1) * lutSize], &temperatureTables[slot * lutSize],
+                   sizeof(int16_t) * lutSize * (temperatureCount - slot));
+        }
+        delete[] temperatureTables;
+        temperatureTables = tables;
+        memmove(&temperatures[slot + 1], &temperatures[slot], sizeof(float) * (temperatureCount - slot));
+        temperatureCount++;
+    }
+
+    temperatures[slot] = temperature;
+    for (int i = 0; i < lutSize; i++) {
+        temperatureTables[slot * lutSize + i] = static_cast<int>(array[i]);
+    }
+    activeTemperature = INT32_MIN;
+    return true;
+}
+
+void LinarADC::blendTemperatureTables(float temperature) {
+    if (!makeTableWritable()) return;
+
+    int upper = 0;
+    while (upper < temperatureCount && temperatures[upper] < temperature) upper++;
+
+    if (upper == 0 || upper == temperatureCount) {
+        // Outside the captured range: clamp to the nearest table
+        const int16_t *table = &temperatureTables[(upper == 0 ? 0 : temperatureCount - 1) * lutSize];
+        for (int i = 0; i < lutSize; i++) calibrationArray[i] = table[i];
+        return;
+    }
+
+    const int16_t *low = &temperatureTables[(upper - 1) * lutSize];
+    const int16_t *high = &temperatureTables[upper * lutSize];
+    int32_t weight = lroundf(256 * (temperature - temperatures[upper - 1]) /
+                             (temperatures[upper] - temperatures[upper - 1]));
+    for (int i = 0; i < lutSize; i++) {
+        // Round half away from zero: division alone would pull falling entries up
+        int32_t step = (high[i] - low[i]) * weight;
+        calibrationArray[i] = low[i] + (step >= 0 ? (step + 128) / 256 : -((128 - step) / 256));
+    }
+}
+
+bool LinarADC::saveAtTemperature(float temperature, dac_channel_t dacChannel) {
 
     //setup
     dac_output_enable(dacChannel);
     dac_output_voltage(dacChannel, 0);
-    analogReadResolution(12);
     delay(1000);
-    if (!spiffsRun()) return false;
-  
-    //generate calibration values
-    generateLut();
+    if (!storageRun()) return false;
+
+    LINAR_LOGI("Calibrating at %.1f C\r\n", temperature);
+    dacCalib = dacChannel;
+    stats.reset();
+    if (!generateLut()) {
+        delete[] results;
+        results = nullptr;
+        return false;
+    }
     printLUT(results);
 
-    if (!triggerLed(saveFile())) return false;
-  
+    readTemperatureTables(*storage, temperaturePath.c_str());
+    bool added = addTemperatureTable(temperature, results);
     delete[] results;
     results = nullptr;
-    
-    if (!triggerLed(calibration())) return false;   
+    if (!triggerLed(added)) return false;
+    LinarPhaseTimer write(stats, LinarPhase::Write);
+    return triggerLed(writeTemperatureTables(*storage, temperaturePath.c_str()));
+}
+
+void LinarADC::setTemperature(float temperature) {
+    if (temperatureCount == 0) return;
+
+    int32_t wholeDegrees = lroundf(temperature);
+    if (wholeDegrees == activeTemperature) return;
+
+    blendTemperatureTables(wholeDegrees);
+    buildMillivoltLut();
+    activeTemperature = wholeDegrees;
+}
+
+bool LinarADC::readEfuseCharacteristics(AdcCharacteristics &chars){
+    esp_adc_cal_characteristics_t adcChars;
+    esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12,
+                                                          defaultVref, &adcChars);
+    if (source == ESP_ADC_CAL_VAL_DEFAULT_VREF) return false;   // nothing burned in the eFuse
+
+    chars.coeffA = adcChars.coeff_a;
+    chars.coeffB = adcChars.coeff_b;
+    chars.vref = adcChars.vref;
+    return true;
+}
+
+double LinarADC::polynomial(int rawValue){
+    // Volts at the pin for an uncalibrated 12-bit reading at 11 dB
+    return -0.000000000000016 * pow(rawValue, 4)
+           + 0.000000000118171 * pow(rawValue, 3)
+           - 0.000000301211691 * pow(rawValue, 2)
+           + 0.001109019271794 * rawValue
+           + 0.034143524634089;
+}
+
+void LinarADC::loadCharacteristics(){
+    hasCharacteristics = characteristicsfcn != nullptr && characteristicsfcn(characteristics);
+
+    if (hasCharacteristics) {
+        LINAR_LOGI("- eFuse characteristics found, Vref %u mV\r\n", characteristics.vref);
+    } else {
+        LINAR_LOGW("- No eFuse characteristics, uncalibrated readings use the polynomial fit\r\n");
+    }
+}
+
+int32_t LinarADC::codeToMillivolts(int32_t code){
+    // Linearized code is in DAC steps of 1/4096 full scale once scaled to 12 bits.
+    // The eFuse coefficients describe the raw ADC, not this scale.
+    code <<= 12 - resolution;
+    return (code * dacFullScale + 2048) / 4096;
+}
+
+int32_t LinarADC::millivoltsToCode(int32_t millivolts){
+    int32_t code = (millivolts * 4096 + dacFullScale / 2) / dacFullScale;
+    int shift = 12 - resolution;
+    return (code + ((1 << shift) >> 1)) >> shift;
+}
+
+int32_t LinarADC::rawToMillivolts(int32_t raw){
+    // Uncalibrated reading: the eFuse line through the raw codes, else the polynomial fit
+    raw <<= 12 - resolution;
+    if (hasCharacteristics) return ((characteristics.coeffA * raw + 32768) >> 16) + characteristics.coeffB;
+    return lroundf(polynomial(raw) * 1000);
+}
+
+void LinarADC::buildMillivoltLut(){
+    if (useCalibration && lut == nullptr) return;     // lazy: readMillivolts() converts as it goes
+
+    for (int i = 0; i < lutSize; i++) {
+        int32_t millivolts;
+        if (useCalibration) {
+            millivolts = codeToMillivolts(constrain(lut[i], 0, lutSize - 1));
+        } else {
+            millivolts = rawToMillivolts(i);
+        }
+        millivoltArray[i] = constrain(millivolts, 0, UINT16_MAX);
+    }
+}
+
+int LinarADC::measureRaw(const int adcPin){
+    uint16_t samples[referenceSamples];
+    selectResolution();
+    for (int i = 0; i < referenceSamples; i++) {
+        samples[i] = analogRead(adcPin);
+        delayMicroseconds(100);
+    }
+    LinarSummary summary;
+    linarKernels(kernels).summarize(samples, referenceSamples, summary);
+    LINAR_LOGD("- reference %u..%u, deviation %.1f LSB\r\n", summary.min, summary.max, sqrt(summary.variance()));
+    return (summary.sum + referenceSamples / 2) / referenceSamples;
+}
+
+bool LinarADC::applyCorrection(int32_t pivot, int32_t target, int32_t gain){
+    LINAR_LOGI("Correcting LUT: code %d -> %d, gain %.4f\r\n", pivot, target, gain / 65536.0);
+
+    int first = -1;
+    int last = -1;
+    if (!makeTableWritable()) return false;
+    if (!correctTable(calibrationArray, pivot, target, gain, first, last)) {
+        LINAR_LOGI("- LUT already matches the reference\r\n");
+        return true;
+    }
+    buildMillivoltLut();
+
+    // Keep the correction across setTemperature() re-blends
+    if (temperatureCount > 0) {
+        for (int t = 0; t < temperatureCount; t++) {
+            int tableFirst = -1;
+            int tableLast = -1;
+            correctTable(&temperatureTables[t * lutSize], pivot, target, gain, tableFirst, tableLast);
+        }
+        return writeTemperatureTables(*storage, temperaturePath.c_str());
+    }
+
+    if (format != BinFile) {
+        LINAR_LOGW("- Correction kept in RAM, only .bin files are patched in place\r\n");
+        return true;
+    }
+    return writeIntRangeToBin(*storage, fullPath.c_str(), calibrationArray, first, last);
+}
+
+bool LinarADC::writeIntRangeToBin(LinarStorage &store, const char *path, int *array, int first, int last) {
+    size_t bytes = (last - first + 1) * sizeof(int);
+    if (!store.writeAt(path, first * sizeof(int), reinterpret_cast<uint8_t *>(&array[first]), bytes)) {
+        LINAR_LOGE("- Failed to open file for patching\r\n");
+        return false;
+    }
+    LINAR_LOGI("- Patched entries %d..%d of .bin\r\n", first, last);
     return true;
 }
 
+bool LinarADC::recalibrate(const int adcPinRef, int referenceMillivolts){
+    if (!useCalibration) {
+        LINAR_LOGE("- No calibration table to correct\r\n");
+        return triggerLed(false);
+    }
+
+    int32_t measured = convert(measureRaw(adcPinRef));
+    return triggerLed(applyCorrection(measured, millivoltsToCode(referenceMillivolts), 65536));
+}
+
+bool LinarADC::recalibrate(const int adcPinRef1, int referenceMillivolts1,
+                           const int adcPinRef2, int referenceMillivolts2){
+    if (!useCalibration) {
+        LINAR_LOGE("- No calibration table to correct\r\n");
+        return triggerLed(false);
+    }
+
+    int32_t measured1 = convert(measureRaw(adcPinRef1));
+    int32_t measured2 = convert(measureRaw(adcPinRef2));
+    int32_t expected1 = millivoltsToCode(referenceMillivolts1);
+    int32_t expected2 = millivoltsToCode(referenceMillivolts2);
+    if (abs(measured2 - measured1) < minReferenceSpan >> (12 - resolution)) {
+        LINAR_LOGE("- Reference points are too close together\r\n");
+        return triggerLed(false);
+    }
+
+    int32_t gain = ((int64_t)(expected2 - expected1) * 65536) / (measured2 - measured1);
+    if (gain < maxGainCorrection[0] || gain > maxGainCorrection[1]) {
+        LINAR_LOGE("- Gain correction %.4f is implausible\r\n", gain / 65536.0);
+        return triggerLed(false);
+    }
+    return triggerLed(applyCorrection(measured1, expected1, gain));
+}
+
 bool LinarADC::begin(){
 
-    analogReadResolution(12);
+    selectResolution();
     delay(100);
 
-    if (!spiffsRun()) return false;
+    useCalibration = false;
+    releaseMapping();
+    releaseLazy();
+    loadCharacteristics();
+    if (storageRun()) {
+        // A table that fails validation is dropped in favour of an older version, if any
+        bool lazy = lazyTable && format == PointsFile;
+        uint32_t start = micros();
+        do {
+            useCalibration = lazy ? openLazy() : mapFile() || openFile();
+        } while (!useCalibration && storage->reject(fullPath.c_str()));
+        loadMicros = micros() - start;
 
-    if (!openFile()) {
-        debugfcn(formatMessage("- Calibration file not found or invalid, using formula\r\n"));
-        return useCalibration = false;
-    }
+        if (useCalibration) {
+            LINAR_LOGI("- Calibration table loaded in %lu us\r\n", (unsigned long)loadMicros);
+        } else {
+            LINAR_LOGW("- Calibration file not found or invalid, using formula\r\n");
+        }
 
-    if (calibrationArray[1000] == 0) { // If the array is zero, then NOT OK 
-        debugfcn(formatMessage("- Calibration file not found or invalid, using formula\r\n"));
-        return useCalibration = false;
+        // The loaded table stays active until setTemperature(); without one, start from the default blend
+        if (readTemperatureTables(*storage, temperaturePath.c_str()) && !useCalibration) {
+            useCalibration = true;
+            blendTemperatureTables(defaultTemperature);
+        }
     }
-    
-    return useCalibration = true;
+
+    buildMillivoltLut();
+    return useCalibration;
 }
 
 int LinarADC::read(const int adcPinRead){
-    int readValue = analogRead(adcPinRead);
-    if (useCalibration) {
-        return calibrationArray[readValue];
-    } else {
-        return int(4096 * (-0.000000000000016 * pow(readValue, 4)
-                        + 0.000000000118171 * pow(readValue, 3)
-                        - 0.000000301211691 * pow(readValue, 2)
-                        + 0.001109019271794 * readValue
-                        + 0.034143524634089) / 3.3);
-    }
-    return 0; 
-}  
+    selectResolution();
+    return convert(analogRead(adcPinRead));
+}
+
+int LinarADC::convert(int raw) const{
+    if (!useCalibration) return formula(raw);
+    if (lut != nullptr) return lut[raw];
+
+    // Lazy table: one more load, the segment is built on its first read
+    const uint16_t *segment = segments[raw / segmentSize];
+    return segment != nullptr ? segment[raw % segmentSize] : buildSegment(raw);
+}
+
+void LinarADC::convertBuffer(const uint16_t *raw, uint16_t *out, size_t count) const{
+    if (useCalibration && lut != nullptr) {
+        linarKernels(kernels).applyLut(lut, lutSize - 1, raw, out, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) out[i] = constrain(convert(raw[i] & (lutSize - 1)), 0, lutSize - 1);
+}
+
+int LinarADC::formula(int raw) const{
+    return int(lutSize * polynomial(raw << (12 - resolution)) / 3.3);
+}
+
+size_t LinarADC::exportTable(Print &out, LinarExportFormat format) const{
+    if (!useCalibration) return 0;
+    if (lut != nullptr) return linarExportTable(out, lut, lutSize, format);
+
+    // A lazy table is exported through convert(), which builds what is missing
+    struct {
+        const LinarADC &adc;
+        int operator[](size_t raw) const { return adc.convert(raw); }
+    } table = {*this};
+    return linarExportTable(out, table, lutSize, format);
+}
+
+int LinarADC::readMillivolts(const int adcPinRead){
+    selectResolution();
+    int raw = analogRead(adcPinRead);
+    if (useCalibration && lut == nullptr) {
+        return constrain(codeToMillivolts(constrain(convert(raw), 0, lutSize - 1)), 0, UINT16_MAX);
+    }
+    return millivoltArray[raw];
+}
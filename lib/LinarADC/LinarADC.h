@@ -2,22 +2,126 @@
 
 #include <Arduino.h>
 #include <driver/dac.h>
+#include <esp_adc_cal.h>
 #include "FS.h"
 #include "SPIFFS.h"
+#include "LinarFsSession.h"
+#include "LinarStorage.h"
+#include "LinarSlotStorage.h"
+#include "LinarCodec.h"
+#include "LinarLog.h"
+#include "LinarExport.h"
+#include "LinarLed.h"
+#include "LinarStats.h"
+#include "LinarBench.h"
+#include "LinarParallel.h"
+#include "LinarKernels.h"
 #include <ArduinoJson.h>
 
+/**
+ * @struct AdcCharacteristics
+ * @brief Per-device scale used to turn raw, uncalibrated ADC codes into millivolts.
+ *
+ * Filled from the eFuse Vref / Two Point data on target. Replace
+ * `LinarADC::characteristicsfcn` to supply synthetic values on the host.
+ *
+ * Only raw readings use it. The eFuse data describes the ADC's own
+ * reference and gain. A calibration table maps raw codes to DAC steps, so
+ * calibration has already replaced that reference with the DAC's, which
+ * runs from VDD. Applying the eFuse line to a calibrated code would scale
+ * it by the ADC reference a second time. Calibrated readings therefore use
+ * `dacFullScale`.
+ */
+struct AdcCharacteristics {
+    uint32_t coeffA;        ///< Gain in millivolts per code, scaled by 65536.
+    uint32_t coeffB;        ///< Offset in millivolts.
+    uint32_t vref;          ///< Reference voltage in millivolts.
+};
+
+/**
+ * @enum LinarLoadError
+ * @brief Why the last calibration table could not be loaded.
+ */
+enum class LinarLoadError : uint8_t {
+    None,           ///< Loaded.
+    NotFound,       ///< No file.
+    ShortRead,      ///< The file or a read ended before the table was complete.
+    ParseError,     ///< Not a valid file of its type.
+    Overflow,       ///< More values than the table and its end point.
+    Timeout,        ///< The storage did not deliver within the load time bound.
+    Invalid,        ///< Values out of range, a drop of more than one DAC step, or a CRC mismatch.
+    NoMemory,       ///< The table could not be allocated.
+    Unsupported,    ///< Unknown file type.
+};
+
+/**
+ * @struct LinarSweepPoint
+ * @brief Raw measurement of one DAC step, as recorded in a ".sweep" file.
+ */
+struct LinarSweepPoint {
+    float filtered;     ///< Filtered reading the table was built from.
+    float mean;         ///< Mean of all samples.
+    float variance;     ///< Sample variance; the running sum of squared deviations while sampling.
+    uint32_t count;     ///< Samples taken.
+
+    /**
+     * @brief Adds a sample to the mean and deviation (Welford's method).
+     */
+    void add(float sample) {
+        count++;
+        float delta = sample - mean;
+        mean += delta / count;
+        variance += delta * (sample - mean);
+    }
+
+    void finish(float value) {
+        filtered = value;
+        variance = count > 1 ? variance / (count - 1) : 0;
+    }
+};
+
+/**
+ * @struct CalibrationReport
+ * @brief Quality metrics of the last calibration check, indexed by DAC step.
+ *
+ * Filled by `save()` in one pass over the DAC steps and written next to the
+ * table as "/<file>.rpt", in JSON, for production test.
+ *
+ * INL and DNL are per DAC step, not per ADC code. The 8-bit DAC only drives
+ * every sweep stride'th code, so a code-density histogram would leave the
+ * codes in between to noise; per-code DNL needs a finer source than the
+ * DAC. `missingCodes` still covers every code, from the table itself.
+ */
+struct CalibrationReport {
+    static constexpr int points = 256;          ///< DAC steps, one sweep stride (16 codes at 12 bits) apart.
+    static constexpr int histogramBins = 16;    ///< Bins of the error histogram.
+    static constexpr int histogramSpan = 32;    ///< Histogram covers -32..+32 LSB, outliers go to the end bins.
+
+    int16_t inl[points];            ///< Calibrated minus ideal code per DAC step, in LSB.
+    int16_t dnl[points];            ///< Calibrated step minus the ideal stride per DAC step, in LSB.
+    uint32_t histogram[histogramBins]; ///< Calibrated error counts, 4 LSB per bin.
+    int pointCount;                 ///< DAC steps measured.
+    int maxInl;                     ///< Signed INL with the largest magnitude.
+    int maxDnl;                     ///< Signed DNL with the largest magnitude.
+    int missingCodes;               ///< Output codes the table never produces.
+    float rmsRaw;                   ///< RMS error before calibration, % of range.
+    float rmsCalibrated;            ///< RMS error after calibration, % of range.
+    bool passed;                    ///< rmsCalibrated within 1 %.
+};
+
 /**
  * @class LinarADC
  * @brief A class for handling ADC of ESP32 operations with optional calibration and result storage.
  * 
  * The `LinarADc` class is designed to manage ADC readings, 
  * handle optional calibration processes, and save results to memory in various formats 
- * (".txt", ".json", ".bin"). It provides utilities for LED status indication, calibration,
+ * (".txt", ".json", ".bin", ".delta"). It provides utilities for LED status indication, calibration,
  *  and storing processed data for further analysis.
  *
  * Key Features:
  * - Perform raw ADC readings or calibrated readings based on the configuration.
- * - Save results of calibration in memory for later use.
+ * - Save results of calibration in memory for later use (SPIFFS, LittleFS, NVS,
+ *   a raw partition or RAM, see `LinarStorage`).
  * - Configurable ADC pin and LEDs for visual feedback.
  *
  * Example usage:
@@ -27,6 +131,8 @@
  * adc.begin(); // Tries to read the file "/CalibrationResults.bin" and runs ADC
  * adc.read(); //  If the file is read successfully then use values from there, 
  *             //  if not use a polynomial
+ * adc.readMillivolts(34); // Same lookup, already scaled to millivolts
+ * adc.setTemperature(41.5); // With tables saved by saveAtTemperature(), blend them for 41.5 °C
  * @endcode
  */
 class LinarADC {
@@ -37,47 +143,302 @@ private:
     int led1Pin;            ///< Pin number for the first LED indicator (green)
     int led2Pin;            ///< Pin number for the second LED indicator (red)
     int adcPinCalib;        ///< ADC pin used for calibration.
+    dac_channel_t dacCalib = DAC_CHANNEL_1; ///< DAC channel wired to adcPinCalib.
+    static constexpr uint32_t settleMicros = 100; ///< DAC settling time before a sample.
+
+    // Resolution
+    uint8_t resolution = 12;    ///< ADC bits, 9..12.
+    int lutSize = 4096;         ///< Table entries, 1 << resolution.
+    int sweepStride = 16;       ///< Codes between two DAC steps, filled in by interpolation.
+    static uint8_t activeResolution; ///< Width analogRead() is currently set to, shared by all objects.
 
     // Work with file
     String fileName;        ///< Name of the file to save results (without extension).
     String fileType;        ///< File type/extension for the saved results (e.g., ".txt").
     String fullPath;        ///< Full file path generated from fileName and fileType.
+    enum FileFormat : uint8_t { TxtFile, JsonFile, BinFile, DeltaFile, PointsFile, UnknownFile };
+    FileFormat format;      ///< fileType, resolved once by the constructor.
+    String reportPath;      ///< Path of the JSON calibration report.
+    String sweepPath;       ///< Path of the recorded sweep.
+    LinarSweepPoint *sweepRecord = nullptr; ///< Statistics of the running sweep, while recording.
+    static constexpr uint32_t sweepMagic = 0x5057534C; ///< "LSWP" file signature.
+    LinarStorage *storage;  ///< Backend holding the files, shared between objects.
 
     // Dynamic arrays to work with calibration values
-    float *results;         ///< Array for storing ADC results
-    float *res2;            ///< Secondary array for additional processing
-    int *calibrationArray;  ///< Array for storing calibration data.
-
-    //For reading 
-    const int maxAttempts = 1000; ///< Max attempts to read from a file a variable
-    int attempts;                 ///< Number of attempts  
-    int value;                    ///< Auxiliary variable to read from the file  
-    
+    float *results;         ///< Array for storing ADC results, allocated for a sweep
+    float *measuredPoints = nullptr; ///< The 256 sweep points kept for a ".points" save.
+    static constexpr uint32_t pointsMagic = 0x5354504C; ///< "LPTS" file signature.
+
+    // Lazy table
+    static constexpr int segmentSize = 64;     ///< Table entries built at a time.
+    float *lazyPoints = nullptr;               ///< Sweep points the segments are built from.
+    bool lazyAscending = true;                 ///< Whether the lazy curve allows the O(N) inversion.
+    mutable uint16_t *segments[4096 / segmentSize] = {}; ///< Built segments, nullptr until first read.
+    mutable int segmentsBuilt = 0;
+    int *calibrationArray;  ///< Heap copy of the calibration data, allocated when needed.
+    const int *mappedTable = nullptr; ///< Calibration data mapped from storage, no heap copy.
+    const int *lut = nullptr; ///< Table used by read(): calibrationArray or mappedTable, nullptr if lazy.
+    CalibrationReport report; ///< Result of the last calibration check.
+    LinarPhaseStats stats = {}; ///< Time per phase of the last calibration run.
+    uint16_t *millivoltArray; ///< Raw code to millivolts, rebuilt by begin().
+
+    // Table validation at load
+    static constexpr size_t loadBlock = 256; ///< Entries read and checked at a time.
+    uint32_t loadMicros = 0;                 ///< Time begin() spent loading the table.
+    uint32_t logMicros = 0;                  ///< Time spent in logMessage().
+    static constexpr uint32_t maxLoadMicros = 500000; ///< Hard bound on loading one file.
+    static constexpr size_t readChunk = 1024; ///< Bytes per storage read of a text file.
+    uint32_t loadStarted = 0;                ///< micros() when the current load began.
+    mutable LinarLoadError loadError = LinarLoadError::None; ///< Result of the last load; a lazy segment build can set it.
+
+    // Voltage scale
+    const uint32_t dacFullScale = 3300; ///< DAC full scale (VDD) in mV, the scale of calibrated codes.
+    static constexpr uint32_t defaultVref = 1100; ///< Vref in mV assumed when the eFuse holds none.
+    AdcCharacteristics characteristics;   ///< Scale read by begin().
+    bool hasCharacteristics = false;      ///< Whether characteristicsfcn supplied a scale.
+
+    // Field recalibration
+    const int referenceSamples = 64;      ///< Readings averaged per reference point.
+    const int minReferenceSpan = 256;     ///< Minimum distance in 12-bit codes between two references.
+    const int32_t maxGainCorrection[2] = {58982, 72090}; ///< Accepted gain range, 0.9..1.1 in Q16.
+
+    // Temperature compensation
+    static constexpr int maxTemperatureTables = 8;      ///< Tables kept in the temperature file.
+    static constexpr uint32_t temperatureMagic = 0x504D544C; ///< "LTMP" file signature.
+    const float defaultTemperature = 25.0;              ///< Blend begin() starts from when there is no main table.
+    String temperaturePath;                             ///< Path of the multi-temperature file.
+    int temperatureCount = 0;                           ///< Number of tables currently loaded.
+    float temperatures[maxTemperatureTables];           ///< Capture temperature of each table, ascending.
+    int16_t *temperatureTables = nullptr;               ///< temperatureCount consecutive lutSize-entry tables, sized to fit.
+    int32_t activeTemperature = INT32_MIN;              ///< Whole degrees calibrationArray was blended for.
+
+    /**
+     * @brief Dumps a table to `debugfcn` at Debug level, one call per chunk.
+     */
+    template <typename T>
+    void printLUT (const T *array){
+        if (LINAR_LOG_LEVEL < (int)LinarLogLevel::Debug || !wantsLog(LinarLogLevel::Debug)) return;
+        uint32_t start = micros();
+        LinarSinkPrint sink(debugfcn);
+        linarExportTable(sink, array, lutSize, LinarExportFormat::CArray);
+        logMicros += micros() - start;
+    }
+
+    /**
+     * @brief Applies table[i] = target + (table[i] - pivot) * gain in place.
+     *
+     * @param gain  Gain in Q16 (65536 = 1.0).
+     * @param first Set to the first changed index, left untouched if none.
+     * @param last  Set to the last changed index.
+     * @return true if any entry changed.
+     */
     template <typename T>
-    void printLUT (T *array){
-        debugfcn(formatMessage("const float ADC_LUT[4096] = {"));
-        for (int i=0; i<4096; i++) {
-            debugfcn(formatMessage("%f,", array[i])); debugfcn(formatMessage(","));
-            if ((i%15)==0) debugfcn(formatMessage("\r\n"));
+    bool correctTable(T *table, int32_t pivot, int32_t target, int32_t gain, int &first, int &last){
+        for (int i = 0; i < lutSize; i++) {
+            int32_t corrected = target + (((int64_t)(table[i] - pivot) * gain + 32768) >> 16);
+            corrected = constrain(corrected, 0, lutSize - 1);
+            if (corrected != table[i]) {
+                if (first < 0) first = i;
+                last = i;
+                table[i] = corrected;
+            }
         }
-        debugfcn(formatMessage("};\r\n"));
+        return first >= 0;
     }
 
-    const char* formatMessage(const char *format, ...);
+    /**
+     * @brief Sample j of the interpolated curve at five samples per code, as the inversion compares them.
+     *
+     * `curve` is the interpolated curve, lutSize + 1 values: a float array or
+     * a `LazyCurve` computing them from the sweep points.
+     */
+    template <typename Curve>
+    float curveSample(const Curve &curve, int j) const {
+        int i = j / 5;
+        return curve[i] + (curve[i + 1] - curve[i]) * (float)(j % 5) / (float)10.0;
+    }
+
+    /**
+     * @brief Index of the first curve sample not below `value`. The samples must ascend.
+     */
+    template <typename Curve>
+    int firstSampleAtLeast(const Curve &curve, float value) const {
+        int low = 0, high = 5 * lutSize;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (curveSample(curve, middle) < value) low = middle + 1; else high = middle;
+        }
+        return low;
+    }
+
+    template <typename Curve>
+    bool curveAscending(const Curve &curve) const {
+        for (int j = 1; j < 5 * lutSize; j++) {
+            if (curveSample(curve, j) < curveSample(curve, j - 1)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Inverts the curve for the output codes first..last-1 into out[0..last-first-1].
+     *
+     * Each entry is the input code, in fifths, whose curve sample is nearest
+     * to the output code; on a tie the earliest sample wins. On an ascending
+     * curve the nearest sample is one of the two around the first sample >=
+     * the code, so one pointer walks the curve once: O(lutSize) instead of
+     * O(lutSize^2). A curve that is not ascending is searched exhaustively.
+     * Both give identical tables.
+     *
+     * @param ascending Result of `curveAscending()`.
+     */
+    template <typename T, typename Curve>
+    void invertCurve(const Curve &curve, T *out, int first, int last, bool ascending) const {
+        const int samples = 5 * lutSize;
+        if (!ascending) {
+            for (int i = first; i < last; i++) {
+                int index = 0;
+                float minDiff = 99999.0;
+                for (int j = 0; j < samples; j++) {
+                    float diff = fabs((float)i - curveSample(curve, j));
+                    if (diff < minDiff) {
+                        minDiff = diff;
+                        index = j;
+                    }
+                }
+                out[i - first] = static_cast<T>((float)index / 5);
+            }
+            return;
+        }
+
+        // k: first sample >= code, run: first sample equal to sample k-1
+        int k = firstSampleAtLeast(curve, first);
+        int run = k > 0 ? firstSampleAtLeast(curve, curveSample(curve, k - 1)) : 0;
+        for (int i = first; i < last; i++) {
+            float code = i;
+            while (k < samples && curveSample(curve, k) < code) {
+                if (k == 0 || curveSample(curve, k) != curveSample(curve, k - 1)) run = k;
+                k++;
+            }
+            int index;
+            if (k == 0) {
+                index = 0;
+            } else if (k == samples) {
+                index = run;
+            } else {
+                index = curveSample(curve, k) - code < code - curveSample(curve, k - 1) ? k : run;
+            }
+            out[i - first] = static_cast<T>((float)index / 5);
+        }
+    }
+
+    /**
+     * @brief Inverts the whole curve into table[0..lutSize-1], split across `buildTasks` parts.
+     *
+     * The output codes are cut into equal ranges, one `invertCurve()` call
+     * each; the ranges only read the curve, so the table is identical to a
+     * single call.
+     *
+     * @return Whether the curve ascends.
+     */
+    template <typename T, typename Curve>
+    bool invertTable(const Curve &curve, T *table) const {
+        struct Job {
+            const LinarADC *adc;
+            const Curve *curve;
+            T *table;
+            bool ascending;
+            int parts;
+        } job = {this, &curve, table, curveAscending(curve), constrain(buildTasks, 1, lutSize - 1)};
+
+        linarParallel(job.parts, [](void *context, int part) {
+            Job &job = *static_cast<Job *>(context);
+            int codes = job.adc->lutSize - 1;
+            int first = 1 + codes * part / job.parts;
+            int last = 1 + codes * (part + 1) / job.parts;
+            job.adc->invertCurve(*job.curve, job.table + first, first, last, job.ascending);
+        }, &job);
+        table[0] = 0;                    // always noise
+        return job.ascending;
+    }
+
+    /**
+     * @brief The interpolated curve of the lazy table, computed point by point as `interpolateCurve()` would.
+     */
+    struct LazyCurve {
+        const LinarADC &adc;
+        float operator[](int x) const { return adc.lazyCurveAt(x); }
+    };
+    float lazyCurveAt(int x) const;
+    int buildSegment(int raw) const;
+    bool openLazy();
+    void releaseLazy();
+
+    void interpolateCurve(float *curve);
+
+    void selectResolution() { selectWidth(resolution); }
+
+    /**
+     * @brief Whether a message at `level` would reach the sink; checked before any formatting.
+     */
+    bool wantsLog(LinarLogLevel level) const { return debugfcn != nullptr && level <= logLevel; }
+    void logMessage(LinarLogLevel level, const char *format, ...) __attribute__((format(printf, 3, 4)));
     void ledIndication(int pin, bool isLong);
     bool triggerLed (const bool status);
-    void deleteFile(fs::FS &fs, const char *path);
-    bool spiffsRun();
+    void deleteFile(LinarStorage &store, const char *path);
+    bool storageRun();
     bool openFile();
+    bool mapFile();
+    void releaseMapping();
+    bool makeTableWritable();
+    /**
+     * @brief Checks entries `first..last` for range and for drops of more than one DAC step.
+     *
+     * Not strictly monotonic: the nearest-sample inversion of a noisy sweep
+     * can step back by up to `sweepStride` codes, so only larger drops count
+     * as corruption. `origin` offsets the logged index.
+     */
+    bool checkNearlyMonotonic(const int *table, size_t first, size_t last, size_t origin = 0);
+    bool checkTable(const int *table);
+    static FileFormat formatOf(const String &type);
     bool saveFile();
-    bool writeFloatAsIntToTxt(fs::FS &fs, const char *path, float *array, size_t size);
-    bool writeFloatAsIntToBin(fs::FS &fs, const char *path, float *array, size_t size);
-    bool writeFloatAsIntToJson(fs::FS &fs, const char *path, float *array, size_t size);
-    bool readIntArrayFromJson(fs::FS &fs, const char *path, int *array, size_t size);
-    bool readIntArrayFromBin(fs::FS &fs, const char *path, int *array, size_t maxSize);
-    bool readIntArrayFromTxt(fs::FS &fs, const char *path, int *array, size_t maxSize);
-    void generateLut();
+    bool writeFloatAsIntToTxt(LinarStorage &store, const char *path, float *array, size_t size);
+    bool writeFloatAsIntToBin(LinarStorage &store, const char *path, float *array, size_t size);
+    bool writeFloatAsIntToJson(LinarStorage &store, const char *path, float *array, size_t size);
+    bool writeFloatAsIntToDelta(LinarStorage &store, const char *path, float *array, size_t size);
+    bool loadTimedOut();
+    bool storedCrcMatches(LinarStorage &store, const char *path, size_t offset, uint32_t crc);
+    char *readBlob(LinarStorage &store, const char *path, size_t &length, LinarLoadError &error);
+    LinarLoadError readIntArrayFromJson(LinarStorage &store, const char *path, int *array, size_t size);
+    LinarLoadError readIntArrayFromBin(LinarStorage &store, const char *path, int *array, size_t maxSize);
+    LinarLoadError readIntArrayFromTxt(LinarStorage &store, const char *path, int *array, size_t maxSize);
+    LinarLoadError readIntArrayFromDelta(LinarStorage &store, const char *path, int *array, size_t maxSize);
+    LinarLoadError readPoints(LinarStorage &store, const char *path, float *points);
+    LinarLoadError readIntArrayFromPoints(LinarStorage &store, const char *path, int *array, size_t size);
+    bool writePoints(LinarStorage &store, const char *path, float *points, size_t count);
+    bool keepPoints();
+    bool allocateResults();
+    void releaseResults();
+    static void sweep(LinarADC **channels, size_t count);
+    void buildLut(float *curve);
+    bool generateLut();
+    bool writeSweep(LinarStorage &store, const char *path);
+    bool readSweep(LinarStorage &store, const char *path, LinarSweepPoint *points, uint8_t &bits);
     bool calibration();
+    bool writeReportToJson(LinarStorage &store, const char *path);
+    void loadCharacteristics();
+    int32_t codeToMillivolts(int32_t code);
+    int32_t millivoltsToCode(int32_t millivolts);
+    int32_t rawToMillivolts(int32_t raw);
+    void buildMillivoltLut();
+    int measureRaw(const int adcPin);
+    bool applyCorrection(int32_t pivot, int32_t target, int32_t gain);
+    bool writeIntRangeToBin(LinarStorage &store, const char *path, int *array, int first, int last);
+    bool readTemperatureTables(LinarStorage &store, const char *path);
+    bool writeTemperatureTables(LinarStorage &store, const char *path);
+    bool addTemperatureTable(float temperature, float *array);
+    void blendTemperatureTables(float temperature);
+    static double polynomial(int rawValue);
+    static bool readEfuseCharacteristics(AdcCharacteristics &chars);
 
 
 public:
@@ -88,35 +449,31 @@ public:
      * @param led1Pin Pin number for the first LED indicator.
      * @param led2Pin Pin number for the second LED indicator.
      * @param file    Name of the file to be saved/read.
-     * @param type    Type of the file to be saved/read (".json", ".txt", ".bin").
+     * @param type    Type of the file to be saved/read (".json", ".txt", ".bin", ".delta").
      */
     LinarADC(int adcCalibration = 34, String type = ".bin", int led1 = -1, int led2 = -1, String file = "CalibrationResults")
         :adcPinCalib(adcCalibration), fileType(type), led1Pin(led1), led2Pin(led2), fileName(file) {
                   
-        results = new float[4097];
-        if (results == nullptr) {
-            debugfcn(formatMessage("Memory allocation failed for results array!\r\n"));
-            ledIndication(led2Pin, true);
-        }
+        results = nullptr;
+        storage = &LinarSlotStorage::spiffs();
         
-        res2 = new float[4096 * 5];
-        if (res2 == nullptr) {
-            debugfcn(formatMessage("Memory allocation failed for res2 array!\r\n"));
-            ledIndication(led2Pin, true);
-        }
+        calibrationArray = nullptr;
 
-        calibrationArray = new int[4096];
-        if (calibrationArray == nullptr) {
-            debugfcn(formatMessage("Memory allocation failed for results array!\r\n"));
+        millivoltArray = new uint16_t[lutSize];
+        if (millivoltArray == nullptr) {
+            LINAR_LOGE("Memory allocation failed for millivolt array!\r\n");
             ledIndication(led2Pin, true);
         }
-        memset(results, 0, sizeof(float) * 4097);
-        memset(res2, 0, sizeof(float) * 4096 * 5);
-        memset(calibrationArray, 0, sizeof(int) * 4096); 
+        memset(millivoltArray, 0, sizeof(uint16_t) * lutSize);
+        memset(&report, 0, sizeof(report));
 
-        debugfcn = [](const char *txt) {};
+        characteristicsfcn = readEfuseCharacteristics;
 
         fullPath = "/" + fileName + fileType;
+        format = formatOf(fileType);
+        temperaturePath = "/" + fileName + ".temp";
+        reportPath = "/" + fileName + ".rpt";
+        sweepPath = "/" + fileName + ".sweep";
 
         pinMode(led1Pin, OUTPUT);
         pinMode(led2Pin, OUTPUT);
@@ -126,24 +483,381 @@ public:
     }
 
     ~LinarADC() {
+    releaseMapping();
     if (results != nullptr) {
         delete[] results;
         results = nullptr;
     }
-    if (res2 != nullptr) {
-        delete[] res2;
-        res2 = nullptr;
-    }
     if (calibrationArray != nullptr) {
         delete[] calibrationArray;
         calibrationArray = nullptr;
     }
+    if (millivoltArray != nullptr) {
+        delete[] millivoltArray;
+        millivoltArray = nullptr;
+    }
+    if (temperatureTables != nullptr) {
+        delete[] temperatureTables;
+        temperatureTables = nullptr;
+    }
+    if (sweepRecord != nullptr) {
+        delete[] sweepRecord;
+        sweepRecord = nullptr;
+    }
+    if (measuredPoints != nullptr) {
+        delete[] measuredPoints;
+        measuredPoints = nullptr;
+    }
+    releaseLazy();
     }
 
-    void (*debugfcn)(const char *txt);
+    /**
+     * @brief Status LEDs, played in the background.
+     *
+     * Success and error blinks are queued and never delay the calibration.
+     * Call `led.setManual(true)` and `led.tick()` from `loop()` to drive them
+     * without a timer.
+     */
+    LinarLed led;
+
+    /**
+     * @brief Keeps the raw measurements of every calibration sweep.
+     *
+     * When set, each sweep also writes "/<file>.sweep": mean, variance and
+     * sample count of every DAC step (4 KB). `replaySweep()` rebuilds the
+     * table from it without the hardware.
+     */
+    bool recordSweeps = false;
+
+    /**
+     * @brief Builds the table on demand, 64 entries at a time, instead of all at `begin()`.
+     *
+     * Only applies to ".points" files. `begin()` then keeps just the sweep
+     * points (1 KB); it still inverts the curve once, a segment at a time,
+     * to check it like a full table. The first `read()` of a code builds the
+     * 64-entry segment holding it (128 bytes), later reads are a lookup. A
+     * channel that only sees a narrow band of codes never builds the rest.
+     * Operations that need the whole table (`recalibrate()`,
+     * `setTemperature()`) build it in full. First reads must not race each
+     * other from several tasks.
+     */
+    bool lazyTable = false;
+
+    /**
+     * @brief Parts the table inversion is split into, one task each; 1 builds on the calling task.
+     *
+     * Defaults to one per core. The extra tasks run on the other core for
+     * the length of the build (4 KB stack each) and the table is the same
+     * for any value.
+     */
+    int buildTasks = linarCoreCount();
+
+    /**
+     * @brief Kernels used by `convertBuffer()` and the reference readings.
+     *
+     * `Vector` by default; `Scalar` is the plain loop, with identical results.
+     */
+    LinarKernelPath kernels = LinarKernelPath::Vector;
+
+    /**
+     * @brief Sink for library messages, none by default.
+     *
+     * Messages are only formatted when a sink is set. Use a `LinarLogRing`
+     * to defer the output.
+     */
+    void (*debugfcn)(const char *txt) = nullptr;
+
+    /**
+     * @brief Most detailed level passed to `debugfcn`.
+     *
+     * `Debug` adds file details and the full table dump. Levels above
+     * `LINAR_LOG_LEVEL` are compiled out regardless.
+     */
+    LinarLogLevel logLevel = LinarLogLevel::Info;
+
+    /**
+     * @brief Time spent formatting and emitting messages, including the sink.
+     */
+    uint32_t getLogMicros() const { return logMicros; }
+    void resetLogMicros() { logMicros = 0; }
+
+    /**
+     * @brief Source of the per-device voltage scale.
+     *
+     * Defaults to the eFuse reader. Only readings without a calibration
+     * table use it, since a table is already referred to the DAC (see
+     * `AdcCharacteristics`). Returns false when the chip holds no
+     * calibration data, in which case the polynomial fit is used instead.
+     */
+    bool (*characteristicsfcn)(AdcCharacteristics &chars);
+
+    /**
+     * @brief Keeps the files of this object in another storage backend.
+     *
+     * By default every object shares `LinarSlotStorage::spiffs()`, A/B slots
+     * on SPIFFS. Call before `save()` or `begin()`.
+     */
+    void useStorage(LinarStorage &backend) { storage = &backend; }
+
+    /**
+     * @brief Runs this channel at 9, 10, 11 or 12 bits (the default).
+     *
+     * The table has one entry per code, so it shrinks with the resolution
+     * (1024 entries at 10 bits), and the calibration interpolates fewer
+     * codes between the 256 DAC steps and builds its table in a fraction of
+     * the time. Objects with different resolutions can be mixed; each sets
+     * the ADC width before it reads. Call before `save()` or `begin()`; a
+     * loaded table is dropped, and a file saved at another resolution is
+     * rejected.
+     *
+     * @param bits ADC resolution.
+     * @return false for an unsupported resolution.
+     */
+    bool setResolution(uint8_t bits);
+    uint8_t getResolution() const { return resolution; }
+
     bool save(dac_channel_t dacChannel = DAC_CHANNEL_1);
+
+    /**
+     * @brief Quality metrics from the check at the end of the last `save()`.
+     */
+    const CalibrationReport &getReport() const { return report; }
+
+    /**
+     * @brief Cycles and microseconds per phase of the last calibration run, plus samples and bytes written.
+     *
+     * Example usage:
+     * @code
+     * adc.save();
+     * const LinarPhaseStats &stats = adc.getStats();
+     * Serial.printf("invert: %lu us\n", stats.microsOf(LinarPhase::Invert));
+     * @endcode
+     */
+    const LinarPhaseStats &getStats() const { return stats; }
+
+    /**
+     * @brief Benchmarks the core operations and writes one JSON line per case to `out`.
+     *
+     * Covers `read()` with the table and with the polynomial, batch
+     * conversion, the same two through `LinarADCFast`, exporting the table, the block kernels on both paths, the LUT build on the recorded sweep (see `recordSweeps`)
+     * or else a fixed synthetic one, and writing and
+     * reading every file format in RAM. Nothing is written to flash, logging
+     * is limited to errors while it runs and the loaded table and stats are
+     * left as they were. See `LinarBench` for the output.
+     *
+     * Only compiled with `LINAR_BENCHMARK` set to 1, so it adds nothing to
+     * other firmware.
+     *
+     * @param out        Target for the results, e.g. `Serial`.
+     * @param adcPin     Pin sampled by the `read()` cases.
+     * @param iterations Iterations of the fast cases; the codecs and exports run 1/1000 of it, the LUT build once.
+     * @return false if a buffer could not be allocated, a codec did not read back what it wrote,
+     *         `LinarADCFast` does not convert like `read()` or the vector kernels differ from the scalar ones.
+     */
+#if LINAR_BENCHMARK
+    bool benchmark(Print &out, int adcPin, uint32_t iterations = 10000);
+#endif
+
+    /**
+     * @brief Builds the table from a recorded sweep instead of measuring it.
+     *
+     * The table becomes the active one, as after `begin()`, but is not
+     * saved; use `exportTable()` or `save()` for that. A sweep recorded at
+     * another resolution is scaled to the current one.
+     *
+     * Example usage:
+     * @code
+     * adc.recordSweeps = true;
+     * adc.save();                          // also writes /CalibrationResults.sweep
+     * ...
+     * adc.replaySweep();                   // same table, no DAC or ADC involved
+     * @endcode
+     *
+     * @param path    Recorded sweep, by default the one of this object.
+     * @param useMean Build from the plain mean instead of the filtered reading.
+     * @return false if the file is missing or invalid, or the result fails validation.
+     */
+    bool replaySweep(const char *path = nullptr, bool useMean = false);
+
+    /**
+     * @brief Calibrates several channels in one session.
+     *
+     * Mounts the storage and waits for the DACs once, sweeps all channels together
+     * and reuses one scratch buffer for the LUT generation of each. Channels
+     * on the same DAC share every settling delay, and each DAC settles while
+     * the channels of the other one are sampled. Every channel is saved and
+     * verified as with `save()`.
+     *
+     * @param channels    Channels to calibrate; the first one prints the session messages.
+     * @param dacChannels DAC channel wired to each channel's calibration pin.
+     * @param count       Number of channels.
+     * @param cycleTimeMs If not null, receives the time of the whole session.
+     * @return true if every channel was saved and passed verification.
+     */
+    static bool saveBatch(LinarADC **channels, const dac_channel_t *dacChannels, size_t count,
+                          uint32_t *cycleTimeMs = nullptr);
+
+    /**
+     * @brief Loads the calibration table, or falls back to the formula.
+     *
+     * The table is validated while it is loaded: a ".bin" file is read in
+     * blocks of 256 entries, each block checked for range and for drops of
+     * more than one DAC step and fed to the CRC kept by the storage, and
+     * loading stops at the first bad block. Every format is decoded into a
+     * buffer of its own, so a table that fails leaves the one in use
+     * untouched. It is rejected and an older version is used if the storage
+     * still has one.
+     *
+     * @return true if a calibration table is in use.
+     */
     bool begin();
+
+    /**
+     * @brief Time the last `begin()` spent loading and validating the table.
+     */
+    uint32_t getLoadMicros() const { return loadMicros; }
+
+    /**
+     * @brief Why the last `begin()` could not load the table, `None` if it did.
+     *
+     * Every read is bounded: a short read, a parse error, too many values or
+     * a storage that stalls for more than 500 ms ends the load with an error
+     * instead of retrying. With `lazyTable`, a segment that cannot be
+     * allocated sets `NoMemory`; that read falls back to the formula.
+     */
+    LinarLoadError getLoadError() const { return loadError; }
+
+    /**
+     * @brief Short description of a load error, for logs.
+     */
+    static const char *errorName(LinarLoadError error);
+
     int read(const int adcPinRead);
+
+    /**
+     * @brief Converts a raw reading the way `read()` does, without reading the ADC.
+     */
+    int convert(int raw) const;
+
+    /**
+     * @brief Converts a block of raw readings, e.g. an ADC DMA buffer, as `convert()` would.
+     *
+     * With a loaded table this is one `applyLut` kernel call over the block.
+     * Readings are masked to the resolution, so channel bits above the data
+     * are ignored. `raw` and `out` may be the same buffer.
+     */
+    void convertBuffer(const uint16_t *raw, uint16_t *out, size_t count) const;
+
+    /**
+     * @brief Converts a raw reading with the polynomial, ignoring any table.
+     */
+    int formula(int raw) const;
+
+    bool isCalibrated() const { return useCalibration; }
+
+    /**
+     * @brief Segments of the lazy table built so far, out of `getSegmentCount()`.
+     *
+     * Both are 0 when the table is not lazy.
+     */
+    int getSegmentsBuilt() const { return segmentsBuilt; }
+    int getSegmentCount() const { return lazyPoints != nullptr ? lutSize / segmentSize : 0; }
+
+    /**
+     * @brief Heap held by the calibration table: the full table, or the points and built segments of a lazy one.
+     */
+    size_t getTableBytes() const;
+
+    /**
+     * @brief Writes the active calibration table to `out`.
+     *
+     * The table is rendered in fixed chunks, so `out` gets a few large writes
+     * instead of one per entry.
+     *
+     * Example usage:
+     * @code
+     * adc.exportTable(Serial);                              // paste into code
+     * adc.exportTable(Serial, LinarExportFormat::Csv);      // spreadsheet
+     * @endcode
+     *
+     * @return Bytes written, 0 if no table is loaded.
+     */
+    size_t exportTable(Print &out, LinarExportFormat format = LinarExportFormat::CArray) const;
+
+    /**
+     * @brief Sets the analogRead() width, skipping the call if it is already set.
+     *
+     * Shared by all objects so channels at different resolutions can be mixed.
+     */
+    static void selectWidth(uint8_t bits) {
+        if (activeResolution == bits) return;
+        analogReadResolution(bits);
+        activeResolution = bits;
+    }
+
+    /**
+     * @brief Reads the ADC and returns the input voltage in millivolts.
+     *
+     * The linearization and the voltage scale are folded into one table by
+     * `begin()`, so the conversion is a single lookup. With a calibration
+     * table the scale is the DAC full scale; without one, the eFuse line
+     * (or the polynomial fit) of the raw reading.
+     *
+     * @param adcPinRead The ADC pin to read from.
+     * @return Input voltage in millivolts.
+     */
+    int readMillivolts(const int adcPinRead);
+
+    /**
+     * @brief Runs the calibration sweep and stores it as the table for one temperature.
+     *
+     * All tables live in "/<file>.temp". A table captured within half a degree
+     * of an existing one replaces it; up to 8 temperatures are kept.
+     *
+     * @param temperature Board/die temperature during the sweep, in °C.
+     * @param dacChannel  DAC channel wired to the calibration pin.
+     * @return true if the table was stored.
+     */
+    bool saveAtTemperature(float temperature, dac_channel_t dacChannel = DAC_CHANNEL_1);
+
+    /**
+     * @brief Selects the calibration for the given temperature.
+     *
+     * Blends the two nearest temperature tables into the active table. The
+     * blend is cached per whole degree, so calling this every sample is cheap
+     * and `read()` stays a single lookup. Does nothing without temperature tables.
+     *
+     * `begin()` loads the temperature tables but keeps the main table active
+     * until this is called; only when there is no main table does it start
+     * from the 25 °C blend.
+     *
+     * @param temperature Current board/die temperature in °C.
+     */
+    void setTemperature(float temperature);
+
+    /**
+     * @brief Corrects the loaded table from one known reference voltage.
+     *
+     * Averages the reading of a pin held at a known voltage and shifts the
+     * whole table so that reading maps to it (offset update). Only the
+     * changed region of a ".bin" file is rewritten; there is no sweep and
+     * no DAC wiring needed. Requires a calibration loaded by `begin()`.
+     *
+     * @param adcPinRef           ADC pin connected to the reference.
+     * @param referenceMillivolts Voltage of the reference in millivolts.
+     * @return true if the table was corrected.
+     */
+    bool recalibrate(const int adcPinRef, int referenceMillivolts);
+
+    /**
+     * @brief Corrects the loaded table from two known reference voltages.
+     *
+     * Same as the single-point version, but updates gain and offset. The two
+     * references should be at least 256 codes apart; gain corrections outside
+     * 0.9..1.1 are rejected as a wiring fault rather than drift.
+     */
+    bool recalibrate(const int adcPinRef1, int referenceMillivolts1,
+                     const int adcPinRef2, int referenceMillivolts2);
 };
 
 
@@ -0,0 +1,241 @@
+#include "LinarADC.h"
+#if LINAR_BENCHMARK
+#include "LinarADCFast.h"
+#include <new>
+
+
+namespace {
+
+// Drops everything written to it, so an export case times only the rendering
+class DiscardPrint : public Print {
+public:
+    size_t write(uint8_t byte) override { return 1; }
+    size_t write(const uint8_t *data, size_t size) override { return size; }
+    using Print::write;
+};
+
+// Times LinarADCFast against the runtime read path, on the same table
+template <uint8_t Bits>
+bool benchFast(LinarBench &bench, const LinarADC &adc, int adcPin, const uint16_t *codes, uint32_t iterations) {
+    LinarADCFast<Bits> *fast = new (std::nothrow) LinarADCFast<Bits>();
+    if (fast == nullptr) return false;
+
+    bool matches = fast->load(adc);
+    if (matches) {
+        bench.run("read_fast", iterations, 0, [&] { bench.keep(fast->read(adcPin)); });
+        bench.run("convert_batch_fast", max(1u, iterations / 256), sizeof(uint16_t) * 256, [&] {
+            for (int i = 0; i < 256; i++) bench.keep(fast->convert(codes[i]));
+        });
+        for (int i = 0; i < LinarADCFast<Bits>::size; i++) {
+            if (fast->convert(i) != constrain(adc.convert(i), 0, LinarADCFast<Bits>::size - 1)) matches = false;
+        }
+    }
+    delete fast;
+    return matches;
+}
+
+}  // namespace
+
+bool LinarADC::benchmark(Print &out, int adcPin, uint32_t iterations){
+    LinarBench bench(out);
+    LinarLogLevel level = logLevel;
+    LinarPhaseStats savedStats = stats;
+    bool calibrated = useCalibration;
+    bool passed = true;
+    logLevel = LinarLogLevel::Error;
+
+    // Conversion
+    if (calibrated) bench.run("read_calibrated", iterations, 0, [&] { bench.keep(read(adcPin)); });
+    useCalibration = false;
+    bench.run("read_formula", iterations, 0, [&] { bench.keep(read(adcPin)); });
+    useCalibration = calibrated;
+
+    uint16_t codes[256];
+    for (int i = 0; i < 256; i++) codes[i] = (i * 97) & (lutSize - 1);
+    bench.run(calibrated ? "convert_batch_calibrated" : "convert_batch_formula",
+              max(1u, iterations / 256), sizeof(codes), [&] {
+        for (int i = 0; i < 256; i++) bench.keep(convert(codes[i]));
+    });
+
+    // The same table through the compile-time read path, for the cycle difference
+    if (calibrated) {
+        bool fast = resolution == 9  ? benchFast<9>(bench, *this, adcPin, codes, iterations)
+                  : resolution == 10 ? benchFast<10>(bench, *this, adcPin, codes, iterations)
+                  : resolution == 11 ? benchFast<11>(bench, *this, adcPin, codes, iterations)
+                  : benchFast<12>(bench, *this, adcPin, codes, iterations);
+        if (!fast) passed = false;
+    }
+
+    // Block kernels on a 256-sample buffer, each path checked against the scalar one
+    uint16_t block[256];
+    if (!linarCheckKernels(LinarKernelPath::Vector)) passed = false;
+    for (LinarKernelPath path : {LinarKernelPath::Scalar, LinarKernelPath::Vector}) {
+        const LinarKernels &kernel = linarKernels(path);
+        char name[32];
+        uint32_t blocks = max(1u, iterations / 256);
+        snprintf(name, sizeof(name), "summarize_%s", kernel.name);
+        bench.run(name, blocks, sizeof(codes), [&] {
+            LinarSummary summary;
+            kernel.summarize(codes, 256, summary);
+            bench.keep(summary.sum);
+        });
+        snprintf(name, sizeof(name), "clamp_scale_%s", kernel.name);
+        bench.run(name, blocks, sizeof(codes), [&] {
+            kernel.clampScale(codes, block, 256, 0, lutSize - 1, 3300 * 4096 / lutSize);
+            bench.keep(block[255]);
+        });
+        if (lut == nullptr) continue;
+        snprintf(name, sizeof(name), "apply_lut_%s", kernel.name);
+        bench.run(name, blocks, sizeof(codes), [&] {
+            kernel.applyLut(lut, lutSize - 1, codes, block, 256);
+            bench.keep(block[255]);
+        });
+    }
+
+    // Table export in each format
+    if (calibrated) {
+        DiscardPrint discard;
+        const struct {
+            const char *name;
+            LinarExportFormat format;
+        } exports[] = {
+            {"export_c_array", LinarExportFormat::CArray},
+            {"export_csv", LinarExportFormat::Csv},
+            {"export_binary", LinarExportFormat::Binary},
+        };
+        for (const auto &exported : exports) {
+            uint32_t bytes = exportTable(discard, exported.format);
+            if (bytes == 0) passed = false;
+            bench.run(exported.name, max(1u, iterations / 1000), bytes, [&] {
+                bench.keep(exportTable(discard, exported.format));
+            });
+        }
+    }
+
+    // LUT build on the recorded sweep if there is one, else on a fixed sweep
+    // with a slight bow, like a real ADC
+    float *savedResults = results;
+    results = nullptr;
+    float *points = new float[256];
+    float *scratch = new float[lutSize + 1];
+    int *table = new int[lutSize];
+    if (points == nullptr || scratch == nullptr || table == nullptr || !allocateResults()) {
+        passed = false;
+    } else {
+        LinarSweepPoint *recorded = storage->size(sweepPath.c_str()) > 0 ? new LinarSweepPoint[256] : nullptr;
+        uint8_t bits;
+        if (recorded != nullptr && readSweep(*storage, sweepPath.c_str(), recorded, bits)) {
+            for (int i = 0; i < 256; i++) points[i] = recorded[i].filtered * lutSize / (1 << bits);
+        } else {
+            for (int i = 0; i < 256; i++) {
+                float x = (float)i / 256;
+                points[i] = constrain((x - 0.06 * x * (1 - x)) * lutSize, 0, lutSize - 1);
+            }
+        }
+        delete[] recorded;
+        auto loadSweep = [&] {
+            for (int i = 0; i < 256; i++) results[i * sweepStride] = points[i];
+        };
+        bench.run("build_lut", 1, 0, [&] {
+            loadSweep();
+            buildLut(scratch);
+        });
+        int savedTasks = buildTasks;
+        buildTasks = 1;
+        bench.run("build_lut_serial", 1, 0, [&] {
+            loadSweep();
+            buildLut(scratch);
+        });
+        buildTasks = savedTasks;
+
+        // File codecs, in RAM so flash speed does not skew the results
+        LinarRamStorage ram;
+        const uint32_t codecIterations = max(1u, iterations / 1000);
+        struct Codec {
+            const char *write;
+            const char *read;
+            const char *path;
+            bool (LinarADC::*writer)(LinarStorage &, const char *, float *, size_t);
+            LinarLoadError (LinarADC::*reader)(LinarStorage &, const char *, int *, size_t);
+        };
+        const Codec codecs[] = {
+            {"write_txt", "read_txt", "/bench.txt", &LinarADC::writeFloatAsIntToTxt, &LinarADC::readIntArrayFromTxt},
+            {"write_json", "read_json", "/bench.json", &LinarADC::writeFloatAsIntToJson, &LinarADC::readIntArrayFromJson},
+            {"write_bin", "read_bin", "/bench.bin", &LinarADC::writeFloatAsIntToBin, &LinarADC::readIntArrayFromBin},
+            {"write_delta", "read_delta", "/bench.delta", &LinarADC::writeFloatAsIntToDelta, &LinarADC::readIntArrayFromDelta},
+        };
+        for (const Codec &codec : codecs) {
+            if (!(this->*codec.writer)(ram, codec.path, results, lutSize + 1)) {
+                passed = false;
+                continue;
+            }
+            uint32_t bytes = ram.size(codec.path);
+            bench.run(codec.write, codecIterations, bytes, [&] {
+                (this->*codec.writer)(ram, codec.path, results, lutSize + 1);
+            });
+
+            LinarLoadError error = LinarLoadError::None;
+            bench.run(codec.read, codecIterations, bytes, [&] {
+                loadStarted = micros();
+                error = (this->*codec.reader)(ram, codec.path, table, lutSize);
+            });
+            if (error != LinarLoadError::None || !checkTable(table)) passed = false;
+        }
+
+        // The measured points alone, with the table built at load
+        if (writePoints(ram, "/bench.points", points, 256)) {
+            uint32_t bytes = ram.size("/bench.points");
+            LinarLoadError error = LinarLoadError::None;
+            bench.run("read_points", codecIterations, bytes, [&] {
+                loadStarted = micros();
+                error = readIntArrayFromPoints(ram, "/bench.points", table, lutSize);
+            });
+            if (error != LinarLoadError::None || !checkTable(table)) passed = false;
+        } else {
+            passed = false;
+        }
+
+        // Lazy table on the same points, swapped in for the run
+        float *savedPoints = lazyPoints;
+        uint16_t *savedSegments[4096 / segmentSize];
+        memcpy(savedSegments, segments, sizeof(segments));
+        int savedBuilt = segmentsBuilt;
+        bool savedAscending = lazyAscending;
+        const int *savedLut = lut;
+
+        lazyPoints = points;
+        memset(segments, 0, sizeof(segments));
+        segmentsBuilt = 0;
+        lazyAscending = curveAscending(LazyCurve{*this});
+        lut = nullptr;
+        useCalibration = true;
+
+        int next = 0;
+        bench.run("lazy_first_hit", lutSize / segmentSize, sizeof(uint16_t) * segmentSize, [&] {
+            bench.keep(convert(next++ * segmentSize));
+        });
+        bench.run("lazy_hit", iterations, 0, [&] { bench.keep(convert(codes[next++ & 0xff])); });
+        for (int i = 0; i < lutSize; i++) {
+            if (convert(i) != table[i]) passed = false;   // same table as the full build
+        }
+
+        for (int i = 0; i < 4096 / segmentSize; i++) delete[] segments[i];
+        lazyPoints = savedPoints;
+        memcpy(segments, savedSegments, sizeof(segments));
+        segmentsBuilt = savedBuilt;
+        lazyAscending = savedAscending;
+        lut = savedLut;
+        useCalibration = calibrated;
+    }
+    delete[] points;
+    delete[] scratch;
+    delete[] table;
+    delete[] results;
+    results = savedResults;
+
+    logLevel = level;
+    stats = savedStats;
+    return passed;
+}
+
+#endif  // LINAR_BENCHMARK
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+#include <limits>
+#include "LinarADC.h"
+
+/**
+ * @class LinarADCFast
+ * @brief Read path with the resolution, table type and mode fixed at compile time.
+ *
+ * `LinarADC::read()` decides at runtime whether a table is loaded and which
+ * resolution is active. Once a channel is set up, those never change, so
+ * this front end takes a snapshot of the conversion into its own table and
+ * `read()` is an `analogRead()` followed by one indexed load, with no
+ * branches. `LinarADC` stays in charge of calibration, storage and
+ * recalibration; call `load()` again after anything that changes its table
+ * (`setTemperature()`, `recalibrate()`). The table lives inside the object
+ * (8 KB at 12 bits with `uint16_t`), so declare it globally, not on the stack.
+ *
+ * @tparam Bits       ADC resolution, 9..12; must match the source.
+ * @tparam T          Table element. `uint16_t` halves the table compared to `int`.
+ * @tparam Calibrated true to use the calibration table, false for the polynomial.
+ *
+ * Example usage:
+ * @code
+ * LinarADC adc(34, ".bin");
+ * LinarADCFast<12> fast;
+ * adc.begin();
+ * fast.load(adc);
+ * int value = fast.read(34);
+ * @endcode
+ */
+template <uint8_t Bits, typename T = uint16_t, bool Calibrated = true>
+class LinarADCFast {
+public:
+    static_assert(Bits >= 9 && Bits <= 12, "LinarADCFast supports 9 to 12 bits");
+    static_assert(std::numeric_limits<T>::max() >= (1 << Bits) - 1, "T cannot hold every code");
+
+    static constexpr int size = 1 << Bits;  ///< Table entries.
+
+    /**
+     * @brief Copies the conversion of `source` into the table and sets the ADC width.
+     *
+     * @return false if the resolution differs, or if `Calibrated` is set and
+     *         `source` has no calibration table.
+     */
+    bool load(const LinarADC &source) {
+        if (source.getResolution() != Bits) return false;
+        if (Calibrated && !source.isCalibrated()) return false;
+
+        for (int i = 0; i < size; i++) {
+            int code = Calibrated ? source.convert(i) : source.formula(i);
+            table[i] = constrain(code, 0, size - 1);
+        }
+        LinarADC::selectWidth(Bits);
+        return true;
+    }
+
+    /**
+     * @brief Reads the ADC and converts the reading.
+     *
+     * The ADC width is not checked on this path; do not change it between
+     * `load()` and `read()`. The mask keeps the lookup in bounds if it was.
+     */
+    inline T read(const int adcPinRead) const {
+        return table[analogRead(adcPinRead) & (size - 1)];
+    }
+
+    /**
+     * @brief Converts a raw reading without reading the ADC.
+     */
+    inline T convert(int raw) const {
+        return table[raw & (size - 1)];
+    }
+
+private:
+    T table[size] = {};
+};
@@ -0,0 +1,47 @@
+#include "LinarBench.h"
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+
+// The host heap stand-in watches a local minimum like ESP-IDF 5.2
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0) || !defined(ESP_PLATFORM)
+#define LINAR_LOCAL_HEAP_MINIMUM 1
+#else
+#define LINAR_LOCAL_HEAP_MINIMUM 0
+#endif
+
+
+void LinarBench::heapStart() {
+    heapBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+#if LINAR_LOCAL_HEAP_MINIMUM
+    heap_caps_monitor_local_minimum_free_size_start();
+#else
+    lowBefore = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+#endif
+}
+
+int32_t LinarBench::heapPeak() {
+    size_t low = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+#if LINAR_LOCAL_HEAP_MINIMUM
+    heap_caps_monitor_local_minimum_free_size_stop();
+#else
+    // Only the global watermark exists; it tells the peak only if the case moved it
+    if (low >= lowBefore) return -1;
+#endif
+    return heapBefore > low ? heapBefore - low : 0;
+}
+
+void LinarBench::emit(const LinarBenchResult &result) {
+    JsonDocument line;
+    line["bench"] = result.name;
+    line["iterations"] = result.iterations;
+    line["nsPerOp"] = result.nsPerOp;
+    line["cyclesPerOp"] = result.cyclesPerOp;
+    line["bytesPerOp"] = result.bytesPerOp;
+    if (result.heapPeak >= 0) {
+        line["heapPeak"] = result.heapPeak;
+    } else {
+        line["heapPeak"] = nullptr;
+    }
+    serializeJson(line, out);
+    out.write('\n');
+}
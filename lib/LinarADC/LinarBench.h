@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "LinarStats.h"
+
+/**
+ * Set to 1 to compile `LinarADC::benchmark()`, e.g.
+ * `build_flags = -DLINAR_BENCHMARK=1`. It is left out of firmware by
+ * default; `LinarBench` itself is always available.
+ */
+#ifndef LINAR_BENCHMARK
+#define LINAR_BENCHMARK 0
+#endif
+
+/**
+ * @struct LinarBenchResult
+ * @brief Outcome of one benchmark case.
+ */
+struct LinarBenchResult {
+    const char *name;
+    uint32_t iterations;
+    float nsPerOp;          ///< Wall time per iteration.
+    float cyclesPerOp;      ///< `linarCycles()` per iteration: CPU cycles on target, nanoseconds on the host.
+    uint32_t bytesPerOp;    ///< Payload handled per iteration, 0 if not applicable.
+    int32_t heapPeak;       ///< Most heap in use during the case above its start, -1 if unknown.
+};
+
+/**
+ * @class LinarBench
+ * @brief Times a callable and writes one JSON line per case to a `Print`.
+ *
+ * Each line looks like
+ * `{"bench":"read_bin","iterations":10,"nsPerOp":812345.5,"cyclesPerOp":194962920,"bytesPerOp":16388,"heapPeak":16412}`
+ * so a CI job can capture the serial output and compare it against a stored
+ * baseline. `cyclesPerOp` resolves cases far shorter than a microsecond. `heapPeak` is exact on ESP-IDF 5.2 and later and on the host; on older
+ * frameworks it is only known when the case lowers the heap watermark and
+ * is `null` otherwise.
+ *
+ * @code
+ * LinarBench bench(Serial);
+ * bench.run("analogRead", 1000, 0, [&] { bench.keep(analogRead(34)); });
+ * @endcode
+ */
+class LinarBench {
+public:
+    LinarBench(Print &target) :out(target) {}
+
+    /**
+     * @brief Runs `op` `iterations` times and reports the case.
+     */
+    template <typename F>
+    LinarBenchResult run(const char *name, uint32_t iterations, uint32_t bytesPerOp, F &&op) {
+        if (iterations == 0) iterations = 1;
+        heapStart();
+        uint32_t start = micros();
+        uint32_t startCycles = linarCycles();
+        for (uint32_t i = 0; i < iterations; i++) op();
+        uint32_t cycles = linarCycles() - startCycles;
+        uint32_t elapsed = micros() - start;
+
+        LinarBenchResult result = {name, iterations, elapsed * 1000.0f / iterations, (float)cycles / iterations,
+                                   bytesPerOp, heapPeak()};
+        emit(result);
+        return result;
+    }
+
+    /**
+     * @brief Consumes a value so the compiler cannot drop the work that produced it.
+     */
+    void keep(int32_t value) { sink = sink + value; }
+
+private:
+    void heapStart();
+    int32_t heapPeak();
+    void emit(const LinarBenchResult &result);
+
+    Print &out;
+    size_t heapBefore = 0;
+    size_t lowBefore = 0;
+    volatile int32_t sink = 0;
+};
@@ -0,0 +1,124 @@
+#include "LinarCodec.h"
+
+
+static inline uint32_t zigZag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unZigZag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+LinarDeltaEncoder::LinarDeltaEncoder(Print &out, uint16_t count) :output(out) {
+    uint32_t signature = magic;
+    uint8_t blockInfo[2] = {blockSize, 0};
+    output.write((const uint8_t *)&signature, sizeof(signature));
+    output.write((const uint8_t *)&count, sizeof(count));
+    output.write(blockInfo, sizeof(blockInfo));
+}
+
+void LinarDeltaEncoder::writeVarint(uint32_t value) {
+    while (value >= 0x80) {
+        output.write((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    output.write((uint8_t)value);
+}
+
+void LinarDeltaEncoder::add(int value) {
+    if (first) {
+        writeVarint(zigZag(value));
+        first = false;
+    } else {
+        block[used++] = zigZag(value - previous - 1);
+        if (used == blockSize) flushBlock();
+    }
+    previous = value;
+}
+
+void LinarDeltaEncoder::flushBlock() {
+    uint32_t all = 0;
+    for (int i = 0; i < used; i++) all |= block[i];
+
+    uint8_t width = 0;
+    while (width < 32 && (all >> width) != 0) width++;
+    output.write(width);
+
+    uint64_t bits = 0;
+    int pending = 0;
+    for (int i = 0; i < used; i++) {
+        bits |= (uint64_t)block[i] << pending;
+        pending += width;
+        while (pending >= 8) {
+            output.write((uint8_t)bits);
+            bits >>= 8;
+            pending -= 8;
+        }
+    }
+    if (pending > 0) output.write((uint8_t)bits);
+    used = 0;
+}
+
+void LinarDeltaEncoder::finish() {
+    if (used > 0) flushBlock();
+}
+
+bool linarDeltaDecode(const uint8_t *data, size_t length, int *table, size_t count) {
+    const uint8_t *end = data + length;
+
+    uint32_t signature;
+    uint16_t stored;
+    if (length < 8 || count == 0) return false;
+    memcpy(&signature, data, sizeof(signature));
+    memcpy(&stored, data + 4, sizeof(stored));
+    uint8_t blockSize = data[6];
+    if (signature != LinarDeltaEncoder::magic || stored < count || blockSize == 0) return false;
+    data += 8;
+
+    uint32_t first = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (data == end || shift > 28) return false;
+        first |= (uint32_t)(*data & 0x7F) << shift;
+        if ((*data++ & 0x80) == 0) break;
+    }
+    int previous = table[0] = unZigZag(first);
+
+    size_t index = 1;
+    while (index < count) {
+        if (data == end) return false;
+        uint8_t width = *data++;
+        if (width > 32) return false;
+
+        size_t inBlock = min((size_t)blockSize, (size_t)stored - index);
+        if ((size_t)(end - data) < (inBlock * width + 7) / 8) return false;
+
+        uint64_t bits = 0;
+        int pending = 0;
+        uint64_t mask = (width == 32) ? 0xFFFFFFFFull : ((1ull << width) - 1);
+        for (size_t i = 0; i < inBlock; i++) {
+            while (pending < width) {
+                bits |= (uint64_t)*data++ << pending;
+                pending += 8;
+            }
+            uint32_t value = bits & mask;
+            bits >>= width;
+            pending -= width;
+            if (index < count) previous = table[index++] = previous + 1 + unZigZag(value);
+        }
+    }
+    return true;
+}
+
+uint32_t linarCrc32(const uint8_t *data, size_t length, uint32_t crc) {
+    static const uint32_t nibbles[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (length--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ nibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ nibbles[crc & 0x0F];
+    }
+    return ~crc;
+}
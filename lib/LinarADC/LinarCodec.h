@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @class LinarDeltaEncoder
+ * @brief Encodes a calibration table as bit-packed deltas (the ".delta" format).
+ *
+ * A table is close to the identity plus a small, smooth correction, so the
+ * step between neighbouring entries is almost always 1. The format stores
+ * the first entry as a zig-zag varint and every following entry as the
+ * zig-zag of (step - 1), packed in blocks of 64 with the smallest bit width
+ * that fits the block. A 4096-entry table takes about 1-1.5 KB instead of
+ * the 16 KB of ".bin".
+ *
+ * Layout (little endian):
+ * - uint32 magic "LDLT", uint16 entry count, uint8 block size, uint8 reserved
+ * - varint zig-zag first entry
+ * - per block: uint8 bit width, then block size * width bits, LSB first
+ *
+ * Example usage:
+ * @code
+ * LinarBuffer buffer;
+ * LinarDeltaEncoder encoder(buffer, 4096);
+ * for (int i = 0; i < 4096; i++) encoder.add(table[i]);
+ * encoder.finish();
+ * @endcode
+ */
+class LinarDeltaEncoder {
+public:
+    static constexpr uint32_t magic = 0x544C444C;  ///< "LDLT"
+    static constexpr int blockSize = 64;           ///< Deltas per bit-width block.
+
+    /**
+     * @brief Writes the header to `out`.
+     *
+     * @param out   Destination of the encoded bytes.
+     * @param count Number of entries that will be added.
+     */
+    LinarDeltaEncoder(Print &out, uint16_t count);
+
+    void add(int value);
+
+    /**
+     * @brief Writes the last, possibly partial, block.
+     */
+    void finish();
+
+private:
+    void writeVarint(uint32_t value);
+    void flushBlock();
+
+    Print &output;
+    int previous = 0;
+    bool first = true;
+    int used = 0;
+    uint32_t block[blockSize];
+};
+
+/**
+ * @brief Decodes a ".delta" blob straight into a table in one pass.
+ *
+ * @param data   Encoded bytes.
+ * @param length Number of encoded bytes.
+ * @param table  Destination table.
+ * @param count  Entries to decode; the blob must hold at least this many.
+ * @return false if the blob is not a delta table or is truncated.
+ */
+bool linarDeltaDecode(const uint8_t *data, size_t length, int *table, size_t count);
+
+/**
+ * @brief CRC-32 (IEEE 802.3, as zlib) of a buffer.
+ *
+ * @param crc Result of the previous chunk, to checksum data in pieces.
+ */
+uint32_t linarCrc32(const uint8_t *data, size_t length, uint32_t crc = 0);
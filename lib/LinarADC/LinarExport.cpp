@@ -0,0 +1,41 @@
+#include "LinarExport.h"
+
+
+void LinarChunkWriter::append(const void *data, size_t length) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    while (length > 0) {
+        size_t part = min(length, chunkSize - used);
+        memcpy(buffer + used, bytes, part);
+        used += part;
+        bytes += part;
+        length -= part;
+        if (used == chunkSize) flush();
+    }
+}
+
+void LinarChunkWriter::appendInt(int32_t value) {
+    char digits[12];
+    int length = snprintf(digits, sizeof(digits), "%ld", (long)value);
+    append(digits, length);
+}
+
+void LinarChunkWriter::flush() {
+    if (used == 0) return;
+    total += out.write(buffer, used);
+    used = 0;
+}
+
+size_t LinarSinkPrint::write(const uint8_t *data, size_t size) {
+    if (sink == nullptr) return 0;
+
+    // The sink takes C strings; one call per chunk
+    char text[LinarChunkWriter::chunkSize + 1];
+    for (size_t done = 0; done < size; ) {
+        size_t part = min(size - done, LinarChunkWriter::chunkSize);
+        memcpy(text, data + done, part);
+        text[part] = '\0';
+        sink(text);
+        done += part;
+    }
+    return size;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @enum LinarExportFormat
+ * @brief Rendering of a table by `linarExportTable()`.
+ */
+enum class LinarExportFormat : uint8_t {
+    CArray,     ///< `const int NAME[N] = { ... };`, 16 values per line, ready to paste into code.
+    Csv,        ///< `code,value` header, then one row per entry.
+    Binary,     ///< Little-endian int32 per entry, the layout of a ".bin" file.
+};
+
+/**
+ * @class LinarChunkWriter
+ * @brief Collects output in a fixed buffer and hands it on one chunk at a time.
+ *
+ * Small pieces (one value, one separator) are cheap to append; the target
+ * only sees writes of `chunkSize` bytes, which keeps a UART or file busy
+ * with large transfers instead of thousands of tiny ones.
+ */
+class LinarChunkWriter {
+public:
+    static constexpr size_t chunkSize = 256;
+
+    LinarChunkWriter(Print &target) :out(target) {}
+    ~LinarChunkWriter() { flush(); }
+
+    void append(const void *data, size_t length);
+    void append(const char *text) { append(text, strlen(text)); }
+    void appendInt(int32_t value);
+    void flush();
+
+    size_t written() const { return total; }  ///< Bytes passed to the target so far.
+
+private:
+    Print &out;
+    uint8_t buffer[chunkSize];
+    size_t used = 0;
+    size_t total = 0;
+};
+
+/**
+ * @class LinarSinkPrint
+ * @brief `Print` that forwards every write as one call to a text sink such as `debugfcn`.
+ */
+class LinarSinkPrint : public Print {
+public:
+    LinarSinkPrint(void (*textSink)(const char *txt)) :sink(textSink) {}
+
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+
+private:
+    void (*sink)(const char *txt);
+};
+
+/**
+ * @brief Renders a table to `out` in chunks of `LinarChunkWriter::chunkSize` bytes.
+ *
+ * Float tables (the sweep results) are exported as the integers that are saved.
+ *
+ * @param out    Target, e.g. `Serial`, a file or a `LinarBuffer`.
+ * @param table  Values to export: an array, or anything with `operator[]`.
+ * @param count  Number of values.
+ * @param format Rendering.
+ * @param name   Array name for `LinarExportFormat::CArray`.
+ * @return Bytes written.
+ */
+template <typename Table>
+size_t linarExportTable(Print &out, const Table &table, size_t count,
+                        LinarExportFormat format, const char *name = "ADC_LUT") {
+    LinarChunkWriter writer(out);
+
+    if (format == LinarExportFormat::Binary) {
+        for (size_t i = 0; i < count; i++) {
+            int32_t value = static_cast<int32_t>(table[i]);
+            writer.append(&value, sizeof(value));
+        }
+    } else if (format == LinarExportFormat::Csv) {
+        writer.append("code,value\r\n");
+        for (size_t i = 0; i < count; i++) {
+            writer.appendInt(i);
+            writer.append(",", 1);
+            writer.appendInt(static_cast<int32_t>(table[i]));
+            writer.append("\r\n", 2);
+        }
+    } else {
+        writer.append("const int ");
+        writer.append(name);
+        writer.append("[");
+        writer.appendInt(count);
+        writer.append("] = {\r\n");
+        for (size_t i = 0; i < count; i++) {
+            writer.append(i % 16 == 0 ? "    " : " ");
+            writer.appendInt(static_cast<int32_t>(table[i]));
+            if (i + 1 < count) writer.append(",", 1);
+            if (i % 16 == 15 || i + 1 == count) writer.append("\r\n", 2);
+        }
+        writer.append("};\r\n");
+    }
+
+    writer.flush();
+    return writer.written();
+}
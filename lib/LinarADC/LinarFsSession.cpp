@@ -0,0 +1,30 @@
+#include "LinarFsSession.h"
+#include "SPIFFS.h"
+#include "LittleFS.h"
+
+
+bool LinarFsSession::mount() {
+    if (mounted) return true;
+
+    uint32_t start = micros();
+    mounted = mountfcn(formatOnFail);
+    lastMountMicros = micros() - start;
+    totalMountMicros += lastMountMicros;
+    mountAttempts++;
+    if (mounted) mountCount++;
+    return mounted;
+}
+
+LinarFsSession &LinarFsSession::spiffs() {
+    static LinarFsSession session(SPIFFS, [](bool formatOnFail) {
+        return SPIFFS.begin(formatOnFail);
+    });
+    return session;
+}
+
+LinarFsSession &LinarFsSession::littleFs() {
+    static LinarFsSession session(LittleFS, [](bool formatOnFail) {
+        return LittleFS.begin(formatOnFail);
+    });
+    return session;
+}
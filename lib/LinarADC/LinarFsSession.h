@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include "FS.h"
+
+/**
+ * @class LinarFsSession
+ * @brief A mounted filesystem shared by any number of `LinarADC` objects.
+ *
+ * The session mounts its filesystem on first use and caches the result, so
+ * `save()` and `begin()` on several channels mount only once. A failed mount
+ * is retried on the next call. The partition is never formatted unless
+ * `formatOnFail` is set.
+ *
+ * The mount function is a plain pointer, so a host build can pass its own
+ * filesystem stand-in and count mounts without any flash.
+ *
+ * Example usage:
+ * @code
+ * LinarADC adc;
+ * LinarFsSession &fs = LinarFsSession::spiffs();
+ * fs.formatOnFail = true;         // opt in to formatting a corrupt partition
+ * LinarSlotStorage storage(LinarFsStorage::spiffs());
+ * adc.useStorage(storage);        // optional, slots on SPIFFS are the default
+ * adc.begin();
+ * Serial.println(fs.getMountCount());
+ * @endcode
+ */
+class LinarFsSession {
+public:
+    /**
+     * @brief Mounts the filesystem.
+     *
+     * @param formatOnFail Whether the partition may be formatted if mounting fails.
+     * @return true if the filesystem is mounted.
+     */
+    typedef bool (*MountFunction)(bool formatOnFail);
+
+    /**
+     * @brief Constructor to initialize the session.
+     *
+     * @param fs    Filesystem used for every file once mounted.
+     * @param mount Function that mounts `fs`.
+     */
+    LinarFsSession(fs::FS &fs, MountFunction mount)
+        :filesystem(fs), mountfcn(mount) {}
+
+    bool formatOnFail = false;  ///< Allow formatting when the mount fails. Off by default.
+
+    /**
+     * @brief Mounts the filesystem unless it is already mounted.
+     *
+     * @return true if the filesystem is mounted.
+     */
+    bool mount();
+
+    /**
+     * @brief Forgets the cached state so the next `mount()` mounts again.
+     *
+     * Call after unmounting the filesystem outside the session.
+     */
+    void invalidate() { mounted = false; }
+
+    bool isMounted() const { return mounted; }
+    fs::FS &fs() { return filesystem; }
+
+    uint32_t getMountCount() const { return mountCount; }         ///< Successful mounts.
+    uint32_t getMountAttempts() const { return mountAttempts; }   ///< Calls to the mount function.
+    uint32_t getLastMountMicros() const { return lastMountMicros; }   ///< Duration of the last attempt.
+    uint32_t getTotalMountMicros() const { return totalMountMicros; } ///< Time spent in all attempts.
+
+    /**
+     * @brief Session shared by every `LinarADC` that was not given another one.
+     */
+    static LinarFsSession &spiffs();
+
+    /**
+     * @brief Shared session on the LittleFS partition.
+     */
+    static LinarFsSession &littleFs();
+
+private:
+    fs::FS &filesystem;
+    MountFunction mountfcn;
+    bool mounted = false;
+
+    uint32_t mountCount = 0;
+    uint32_t mountAttempts = 0;
+    uint32_t lastMountMicros = 0;
+    uint32_t totalMountMicros = 0;
+};
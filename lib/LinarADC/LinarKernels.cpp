@@ -0,0 +1,348 @@
+#include "LinarKernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define LINAR_KERNELS_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define LINAR_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+
+// Scalar reference
+
+static void applyLutScalar(const int *table, uint16_t mask, const uint16_t *in, uint16_t *out, size_t count) {
+    for (size_t i = 0; i < count; i++) out[i] = table[in[i] & mask];
+}
+
+static void summarizeTail(const uint16_t *in, size_t count, LinarSummary &summary) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t sample = in[i];
+        summary.min = min(summary.min, (uint16_t)sample);
+        summary.max = max(summary.max, (uint16_t)sample);
+        summary.sum += sample;
+        summary.sumSquares += sample * sample;
+    }
+}
+
+static void summarizeBegin(size_t count, LinarSummary &summary) {
+    summary = {UINT16_MAX, 0, (uint32_t)count, 0, 0};
+}
+
+static void summarizeEnd(LinarSummary &summary) {
+    if (summary.count == 0) summary.min = 0;
+}
+
+static void summarizeScalar(const uint16_t *in, size_t count, LinarSummary &summary) {
+    summarizeBegin(count, summary);
+    summarizeTail(in, count, summary);
+    summarizeEnd(summary);
+}
+
+static void clampScaleScalar(const uint16_t *in, uint16_t *out, size_t count, uint16_t low, uint16_t high, uint16_t gain) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t scaled = (uint32_t)constrain(in[i], low, high) * gain >> 12;
+        out[i] = min(scaled, (uint32_t)UINT16_MAX);
+    }
+}
+
+static const LinarKernels scalarKernels = {"scalar", applyLutScalar, summarizeScalar, clampScaleScalar};
+
+
+#if defined(LINAR_KERNELS_X86)
+
+// SSE2 is part of x86-64, AVX2 is checked at runtime for the gather
+
+__attribute__((target("avx2")))
+static void applyLutAvx2(const int *table, uint16_t mask, const uint16_t *in, uint16_t *out, size_t count) {
+    const __m256i masks = _mm256_set1_epi32(mask);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i codes = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(in + i)));
+        __m256i values = _mm256_i32gather_epi32(table, _mm256_and_si256(codes, masks), 4);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(values, values), 0x08);
+        _mm_storeu_si128((__m128i *)(out + i), _mm256_castsi256_si128(packed));
+    }
+    applyLutScalar(table, mask, in + i, out + i, count - i);
+}
+
+static void applyLutSse2(const int *table, uint16_t mask, const uint16_t *in, uint16_t *out, size_t count) {
+    // No gather before AVX2; four independent loads per round
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint16_t a = table[in[i] & mask], b = table[in[i + 1] & mask];
+        uint16_t c = table[in[i + 2] & mask], d = table[in[i + 3] & mask];
+        out[i] = a;
+        out[i + 1] = b;
+        out[i + 2] = c;
+        out[i + 3] = d;
+    }
+    applyLutScalar(table, mask, in + i, out + i, count - i);
+}
+
+static void summarizeSse2(const uint16_t *in, size_t count, LinarSummary &summary) {
+    summarizeBegin(count, summary);
+    // SSE2 only compares signed words: flip the sign bit on the way in and out
+    const __m128i sign = _mm_set1_epi16((short)0x8000);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lowest = _mm_set1_epi16(0x7fff);
+    __m128i highest = _mm_set1_epi16((short)0x8000);
+    __m128i sums = zero, squares = zero;
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i flipped = _mm_xor_si128(samples, sign);
+        lowest = _mm_min_epi16(lowest, flipped);
+        highest = _mm_max_epi16(highest, flipped);
+
+        __m128i low = _mm_unpacklo_epi16(samples, zero);
+        __m128i high = _mm_unpackhi_epi16(samples, zero);
+        __m128i pairs = _mm_add_epi32(low, high);
+        sums = _mm_add_epi64(sums, _mm_add_epi64(_mm_unpacklo_epi32(pairs, zero), _mm_unpackhi_epi32(pairs, zero)));
+        squares = _mm_add_epi64(squares, _mm_mul_epu32(low, low));
+        squares = _mm_add_epi64(squares, _mm_mul_epu32(_mm_srli_epi64(low, 32), _mm_srli_epi64(low, 32)));
+        squares = _mm_add_epi64(squares, _mm_mul_epu32(high, high));
+        squares = _mm_add_epi64(squares, _mm_mul_epu32(_mm_srli_epi64(high, 32), _mm_srli_epi64(high, 32)));
+    }
+
+    uint16_t lanes[8];
+    uint64_t totals[2];
+    _mm_storeu_si128((__m128i *)lanes, _mm_xor_si128(lowest, sign));
+    for (uint16_t lane : lanes) summary.min = min(summary.min, lane);
+    _mm_storeu_si128((__m128i *)lanes, _mm_xor_si128(highest, sign));
+    for (uint16_t lane : lanes) summary.max = max(summary.max, lane);
+    _mm_storeu_si128((__m128i *)totals, sums);
+    summary.sum = totals[0] + totals[1];
+    _mm_storeu_si128((__m128i *)totals, squares);
+    summary.sumSquares = totals[0] + totals[1];
+
+    summarizeTail(in + i, count - i, summary);
+    summarizeEnd(summary);
+}
+
+static void clampScaleSse2(const uint16_t *in, uint16_t *out, size_t count, uint16_t low, uint16_t high, uint16_t gain) {
+    const __m128i sign = _mm_set1_epi16((short)0x8000);
+    const __m128i lows = _mm_set1_epi16((short)(low ^ 0x8000));
+    const __m128i highs = _mm_set1_epi16((short)(high ^ 0x8000));
+    const __m128i gains = _mm_set1_epi16((short)gain);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i samples = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(in + i)), sign);
+        samples = _mm_xor_si128(_mm_min_epi16(_mm_max_epi16(samples, lows), highs), sign);
+
+        // 32-bit product from its halves, shifted right by 12
+        __m128i productLow = _mm_mullo_epi16(samples, gains);
+        __m128i productHigh = _mm_mulhi_epu16(samples, gains);
+        __m128i scaled = _mm_or_si128(_mm_slli_epi16(productHigh, 4), _mm_srli_epi16(productLow, 12));
+        __m128i fits = _mm_cmpeq_epi16(_mm_srli_epi16(productHigh, 12), zero);
+        scaled = _mm_or_si128(_mm_and_si128(fits, scaled), _mm_andnot_si128(fits, _mm_cmpeq_epi16(zero, zero)));
+        _mm_storeu_si128((__m128i *)(out + i), scaled);
+    }
+    clampScaleScalar(in + i, out + i, count - i, low, high, gain);
+}
+
+static const LinarKernels sse2Kernels = {"sse2", applyLutSse2, summarizeSse2, clampScaleSse2};
+static const LinarKernels avx2Kernels = {"avx2", applyLutAvx2, summarizeSse2, clampScaleSse2};
+
+static const LinarKernels &vectorKernels() {
+    static const LinarKernels &best = __builtin_cpu_supports("avx2") ? avx2Kernels : sse2Kernels;
+    return best;
+}
+
+#elif defined(LINAR_KERNELS_NEON)
+
+static void applyLutNeon(const int *table, uint16_t mask, const uint16_t *in, uint16_t *out, size_t count) {
+    // NEON has no gather; load the indices as a vector, look up four at a time
+    const uint16x8_t masks = vdupq_n_u16(mask);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16_t codes[8];
+        vst1q_u16(codes, vandq_u16(vld1q_u16(in + i), masks));
+        uint16_t values[8];
+        for (int lane = 0; lane < 8; lane++) values[lane] = table[codes[lane]];
+        vst1q_u16(out + i, vld1q_u16(values));
+    }
+    applyLutScalar(table, mask, in + i, out + i, count - i);
+}
+
+static void summarizeNeon(const uint16_t *in, size_t count, LinarSummary &summary) {
+    summarizeBegin(count, summary);
+    uint16x8_t lowest = vdupq_n_u16(UINT16_MAX);
+    uint16x8_t highest = vdupq_n_u16(0);
+    uint64x2_t sums = vdupq_n_u64(0), squares = vdupq_n_u64(0);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t samples = vld1q_u16(in + i);
+        lowest = vminq_u16(lowest, samples);
+        highest = vmaxq_u16(highest, samples);
+        sums = vpadalq_u32(sums, vpaddlq_u16(samples));
+        squares = vpadalq_u32(squares, vmull_u16(vget_low_u16(samples), vget_low_u16(samples)));
+        squares = vpadalq_u32(squares, vmull_u16(vget_high_u16(samples), vget_high_u16(samples)));
+    }
+    if (i > 0) {
+        summary.min = vminvq_u16(lowest);
+        summary.max = vmaxvq_u16(highest);
+        summary.sum = vaddvq_u64(sums);
+        summary.sumSquares = vaddvq_u64(squares);
+    }
+    summarizeTail(in + i, count - i, summary);
+    summarizeEnd(summary);
+}
+
+static void clampScaleNeon(const uint16_t *in, uint16_t *out, size_t count, uint16_t low, uint16_t high, uint16_t gain) {
+    const uint16x8_t lows = vdupq_n_u16(low);
+    const uint16x8_t highs = vdupq_n_u16(high);
+    const uint16x4_t gains = vdup_n_u16(gain);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t samples = vminq_u16(vmaxq_u16(vld1q_u16(in + i), lows), highs);
+        uint32x4_t productLow = vmull_u16(vget_low_u16(samples), gains);
+        uint32x4_t productHigh = vmull_u16(vget_high_u16(samples), gains);
+        vst1q_u16(out + i, vcombine_u16(vqshrn_n_u32(productLow, 12), vqshrn_n_u32(productHigh, 12)));
+    }
+    clampScaleScalar(in + i, out + i, count - i, low, high, gain);
+}
+
+static const LinarKernels neonKernels = {"neon", applyLutNeon, summarizeNeon, clampScaleNeon};
+
+static const LinarKernels &vectorKernels() {
+    return neonKernels;
+}
+
+#else
+
+// The ESP32 has no SIMD unit (the S3 has one, but no DAC to calibrate
+// with): unroll by four so loads of the next samples overlap the lookups
+
+static void applyLutUnrolled(const int *table, uint16_t mask, const uint16_t *in, uint16_t *out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint16_t a = table[in[i] & mask], b = table[in[i + 1] & mask];
+        uint16_t c = table[in[i + 2] & mask], d = table[in[i + 3] & mask];
+        out[i] = a;
+        out[i + 1] = b;
+        out[i + 2] = c;
+        out[i + 3] = d;
+    }
+    applyLutScalar(table, mask, in + i, out + i, count - i);
+}
+
+static void summarizeUnrolled(const uint16_t *in, size_t count, LinarSummary &summary) {
+    summarizeBegin(count, summary);
+    // Two sets of accumulators halve the dependency chains
+    uint32_t lowA = UINT16_MAX, lowB = UINT16_MAX, highA = 0, highB = 0;
+    uint32_t sumA = 0, sumB = 0;
+    uint64_t squaresA = 0, squaresB = 0;
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        uint32_t a = in[i], b = in[i + 1];
+        lowA = min(lowA, a);
+        lowB = min(lowB, b);
+        highA = max(highA, a);
+        highB = max(highB, b);
+        sumA += a;
+        sumB += b;
+        squaresA += a * a;
+        squaresB += b * b;
+        if ((i & 0x7ffe) == 0x7ffe) {   // 32-bit sums, flushed before they can wrap
+            summary.sum += (uint64_t)sumA + sumB;
+            sumA = sumB = 0;
+        }
+    }
+    summary.min = min(lowA, lowB);
+    summary.max = max(highA, highB);
+    summary.sum += (uint64_t)sumA + sumB;
+    summary.sumSquares = squaresA + squaresB;
+    summarizeTail(in + i, count - i, summary);
+    summarizeEnd(summary);
+}
+
+static void clampScaleUnrolled(const uint16_t *in, uint16_t *out, size_t count, uint16_t low, uint16_t high, uint16_t gain) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t a = (uint32_t)constrain(in[i], low, high) * gain >> 12;
+        uint32_t b = (uint32_t)constrain(in[i + 1], low, high) * gain >> 12;
+        uint32_t c = (uint32_t)constrain(in[i + 2], low, high) * gain >> 12;
+        uint32_t d = (uint32_t)constrain(in[i + 3], low, high) * gain >> 12;
+        out[i] = min(a, (uint32_t)UINT16_MAX);
+        out[i + 1] = min(b, (uint32_t)UINT16_MAX);
+        out[i + 2] = min(c, (uint32_t)UINT16_MAX);
+        out[i + 3] = min(d, (uint32_t)UINT16_MAX);
+    }
+    clampScaleScalar(in + i, out + i, count - i, low, high, gain);
+}
+
+static const LinarKernels unrolledKernels = {"unrolled", applyLutUnrolled, summarizeUnrolled, clampScaleUnrolled};
+
+static const LinarKernels &vectorKernels() {
+    return unrolledKernels;
+}
+
+#endif
+
+
+const LinarKernels &linarKernels(LinarKernelPath path) {
+    return path == LinarKernelPath::Vector ? vectorKernels() : scalarKernels;
+}
+
+bool linarCheckKernels(LinarKernelPath path) {
+    const LinarKernels &kernels = linarKernels(path);
+    const size_t blockSize = 300;
+    const int tableSize = 256;
+
+    int *table = new int[tableSize];
+    uint16_t *in = new uint16_t[blockSize];
+    uint16_t *expected = new uint16_t[blockSize];
+    uint16_t *actual = new uint16_t[blockSize];
+    bool passed = table != nullptr && in != nullptr && expected != nullptr && actual != nullptr;
+
+    if (passed) {
+        // Fixed pseudo-random data with the 16-bit limits mixed in
+        uint32_t seed = 0x4C494E41;
+        for (int i = 0; i < tableSize; i++) {
+            seed = seed * 1664525 + 1013904223;
+            table[i] = seed >> 16;
+        }
+        for (size_t i = 0; i < blockSize; i++) {
+            seed = seed * 1664525 + 1013904223;
+            in[i] = i % 37 == 0 ? 0 : i % 41 == 0 ? UINT16_MAX : seed >> 16;
+        }
+    }
+
+    // Every length up to 40 covers all the tails, then a few long blocks
+    const uint16_t gains[] = {4096, 1000, 65535};
+    for (size_t count = 0; passed && count <= blockSize; count += count < 40 ? 1 : 37) {
+        applyLutScalar(table, tableSize - 1, in, expected, count);
+        kernels.applyLut(table, tableSize - 1, in, actual, count);
+        passed = memcmp(expected, actual, count * sizeof(uint16_t)) == 0;
+
+        memcpy(actual, in, count * sizeof(uint16_t));
+        kernels.applyLut(table, tableSize - 1, actual, actual, count);
+        passed = passed && memcmp(expected, actual, count * sizeof(uint16_t)) == 0;
+
+        LinarSummary reference, summary;
+        summarizeScalar(in, count, reference);
+        kernels.summarize(in, count, summary);
+        passed = passed && summary.min == reference.min && summary.max == reference.max &&
+                 summary.count == reference.count && summary.sum == reference.sum &&
+                 summary.sumSquares == reference.sumSquares;
+
+        for (uint16_t gain : gains) {
+            clampScaleScalar(in, expected, count, 100, 60000, gain);
+            kernels.clampScale(in, actual, count, 100, 60000, gain);
+            passed = passed && memcmp(expected, actual, count * sizeof(uint16_t)) == 0;
+        }
+    }
+
+    delete[] table;
+    delete[] in;
+    delete[] expected;
+    delete[] actual;
+    return passed;
+}
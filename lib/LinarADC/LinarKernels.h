@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @struct LinarSummary
+ * @brief Minimum, maximum, sum and sum of squares of a block of 16-bit samples.
+ */
+struct LinarSummary {
+    uint16_t min;           ///< Smallest sample, 0 for an empty block.
+    uint16_t max;           ///< Largest sample, 0 for an empty block.
+    uint32_t count;         ///< Samples summarized.
+    uint64_t sum;
+    uint64_t sumSquares;
+
+    float mean() const { return count > 0 ? (float)sum / count : 0; }
+
+    /**
+     * @brief Sample variance, as `LinarSweepPoint` reports it.
+     */
+    float variance() const {
+        if (count < 2) return 0;
+        double average = (double)sum / count;
+        return (float)(((double)sumSquares - average * sum) / (count - 1));
+    }
+};
+
+/**
+ * @enum LinarKernelPath
+ * @brief Implementation of the block kernels.
+ */
+enum class LinarKernelPath : uint8_t {
+    Scalar,     ///< Plain loops, one sample at a time; the reference.
+    Vector,     ///< AVX2/SSE2 or NEON on a host, unrolled loops on the ESP32.
+};
+
+/**
+ * @struct LinarKernels
+ * @brief Block operations on 16-bit samples, e.g. an ADC DMA buffer.
+ *
+ * Every path gives exactly the scalar results; `linarCheckKernels()`
+ * compares them. `in` and `out` may be the same buffer.
+ */
+struct LinarKernels {
+    const char *name;       ///< "scalar", "avx2", "sse2", "neon" or "unrolled".
+
+    /**
+     * @brief out[i] = table[in[i] & mask]; the table entries must fit 16 bits.
+     */
+    void (*applyLut)(const int *table, uint16_t mask, const uint16_t *in, uint16_t *out, size_t count);
+
+    /**
+     * @brief Minimum, maximum, sum and sum of squares of in[0..count-1].
+     */
+    void (*summarize)(const uint16_t *in, size_t count, LinarSummary &summary);
+
+    /**
+     * @brief out[i] = constrain(in[i], low, high) * gain / 4096, saturated at 65535.
+     *
+     * `gain` is fixed point with 12 fraction bits: 4096 is 1.0, 65535 almost 16.
+     */
+    void (*clampScale)(const uint16_t *in, uint16_t *out, size_t count, uint16_t low, uint16_t high, uint16_t gain);
+};
+
+/**
+ * @brief Kernels of `path`. `Vector` picks the best the build and the CPU support.
+ */
+const LinarKernels &linarKernels(LinarKernelPath path);
+
+/**
+ * @brief Runs the kernels of `path` and the scalar ones on the same test blocks.
+ *
+ * The blocks cover every tail length, the 16-bit limits and in-place use.
+ *
+ * @return false if any output differs or the test buffers could not be allocated.
+ */
+bool linarCheckKernels(LinarKernelPath path);
@@ -0,0 +1,98 @@
+#include "LinarLed.h"
+
+
+LinarLed::~LinarLed() {
+    stopTimer();
+    if (phase == On) digitalWrite(current.pin, HIGH);
+}
+
+bool LinarLed::blink(int pin, uint16_t onMs, uint16_t offMs) {
+    if (pin == -1) return false;
+
+    uint32_t writeAt = head.load(std::memory_order_relaxed);
+    if (writeAt - tail.load(std::memory_order_acquire) >= queueSize) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    queue[writeAt % queueSize] = {pin, onMs, offMs};
+    active.store(true, std::memory_order_release);
+    head.store(writeAt + 1, std::memory_order_release);
+
+    if (!manual) startTimer();
+    return true;
+}
+
+void LinarLed::tick(uint32_t nowMs) {
+    while (true) {
+        if (phase == Idle) {
+            uint32_t readAt = tail.load(std::memory_order_relaxed);
+            if (readAt == head.load(std::memory_order_acquire)) {
+                active.store(false, std::memory_order_release);
+                if (!manual) pauseTimer();     // nothing to play until the next blink()
+
+                // A pattern queued in between sets it again, and may have missed the pause
+                if (readAt == head.load(std::memory_order_acquire)) return;
+                active.store(true, std::memory_order_release);
+                if (!manual) startTimer();
+            }
+            current = queue[readAt % queueSize];
+            tail.store(readAt + 1, std::memory_order_release);
+
+            digitalWrite(current.pin, LOW);
+            phase = On;
+            phaseEnd = nowMs + current.onMs;
+        }
+
+        if ((int32_t)(nowMs - phaseEnd) < 0) return;
+
+        if (phase == On) {
+            digitalWrite(current.pin, HIGH);
+            phase = Off;
+            phaseEnd += current.offMs;
+        } else {
+            phase = Idle;
+        }
+    }
+}
+
+void LinarLed::setManual(bool manualTick) {
+    manual = manualTick;
+    if (manual) {
+        stopTimer();
+    } else if (busy()) {
+        startTimer();
+    }
+}
+
+bool LinarLed::startTimer() {
+    if (timer == nullptr) {
+        esp_timer_create_args_t args = {};
+        args.callback = onTimer;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "linar_led";
+        if (esp_timer_create(&args, &timer) != ESP_OK) {
+            timer = nullptr;
+            return false;
+        }
+    }
+
+    // Already running is fine: the pattern is played on the next period
+    esp_err_t started = esp_timer_start_periodic(timer, timerPeriodMs * 1000);
+    return started == ESP_OK || started == ESP_ERR_INVALID_STATE;
+}
+
+void LinarLed::pauseTimer() {
+    if (timer != nullptr) esp_timer_stop(timer);
+}
+
+void LinarLed::stopTimer() {
+    if (timer == nullptr) return;
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    timer = nullptr;
+}
+
+void LinarLed::onTimer(void *arg) {
+    static_cast<LinarLed *>(arg)->tick();
+}
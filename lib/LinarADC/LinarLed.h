@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <atomic>
+
+/**
+ * @class LinarLed
+ * @brief Plays LED blink patterns in the background instead of with delay().
+ *
+ * `blink()` only queues a pattern and returns. The patterns are played by
+ * `tick()`, which by default runs from a periodic esp_timer, so calibration
+ * and file I/O never wait for an LED. The timer is started by `blink()` and
+ * stops itself once the queue is empty, so an idle LED costs no wakeups. With
+ * `setManual(true)` no timer is used and the application calls `tick()`,
+ * e.g. from `loop()`; `tick(now)` takes the time explicitly, so a sequence
+ * can also be stepped with a simulated clock.
+ *
+ * LEDs are active low, as wired on the calibration board. One task queues
+ * while the timer (or the single task calling `tick()`) plays; a pattern that
+ * does not fit in the queue is dropped and counted.
+ */
+class LinarLed {
+public:
+    static constexpr int queueSize = 8;             ///< Patterns waiting to be played.
+    static constexpr uint32_t timerPeriodMs = 10;   ///< Resolution of the background timer.
+
+    LinarLed() = default;
+    LinarLed(const LinarLed &) = delete;
+    LinarLed &operator=(const LinarLed &) = delete;
+    ~LinarLed();
+
+    /**
+     * @brief Queues one blink: `pin` on for `onMs`, then off for `offMs`.
+     *
+     * @return false if the pin is -1 or the queue is full.
+     */
+    bool blink(int pin, uint16_t onMs, uint16_t offMs);
+
+    /**
+     * @brief Advances the patterns to `nowMs`. Call from one task only.
+     */
+    void tick(uint32_t nowMs);
+    void tick() { tick(millis()); }
+
+    /**
+     * @brief Drives the LEDs from `tick()` calls only (true) or from the timer (false, default).
+     */
+    void setManual(bool manual);
+
+    bool busy() const { return active.load(std::memory_order_acquire); } ///< A pattern is queued or playing.
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); } ///< Patterns lost to a full queue.
+
+private:
+    enum Phase : uint8_t { Idle, On, Off };
+
+    struct Pattern {
+        int pin;
+        uint16_t onMs;
+        uint16_t offMs;
+    };
+
+    bool startTimer();
+    void pauseTimer();
+    void stopTimer();
+    static void onTimer(void *arg);
+
+    Pattern queue[queueSize];
+    std::atomic<uint32_t> head{0};      ///< Total patterns queued.
+    std::atomic<uint32_t> tail{0};      ///< Total patterns taken by tick().
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<bool> active{false};
+
+    // Player state, owned by tick()
+    Pattern current = {-1, 0, 0};
+    Phase phase = Idle;
+    uint32_t phaseEnd = 0;
+
+    esp_timer_handle_t timer = nullptr;
+    bool manual = false;
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+/**
+ * @enum LinarLogLevel
+ * @brief Severity of a library message; a message is emitted at or below the active level.
+ */
+enum class LinarLogLevel : uint8_t {
+    None,       ///< Nothing.
+    Error,      ///< Operation failed.
+    Warning,    ///< Fallback taken, e.g. the formula instead of a table.
+    Info,       ///< Progress and results of save() and begin().
+    Debug,      ///< File details and the full table dump.
+};
+
+/**
+ * Highest level compiled into the library, 0 (none) to 4 (debug). Messages
+ * above it are removed by the compiler, arguments included, e.g.
+ * `build_flags = -DLINAR_LOG_LEVEL=1` keeps errors only.
+ */
+#ifndef LINAR_LOG_LEVEL
+#define LINAR_LOG_LEVEL 4
+#endif
+
+/**
+ * Logs through `object`. Nothing is formatted unless the level is compiled
+ * in, a sink is attached and the level is enabled at runtime.
+ */
+#define LINAR_LOG_AT(object, level, ...)                                          \
+    do {                                                                          \
+        if ((int)(level) <= LINAR_LOG_LEVEL && (object).wantsLog(level)) {      \
+            (object).logMessage(level, __VA_ARGS__);                              \
+        }                                                                         \
+    } while (0)
+
+#define LINAR_LOGE(...) LINAR_LOG_AT(*this, LinarLogLevel::Error, __VA_ARGS__)
+#define LINAR_LOGW(...) LINAR_LOG_AT(*this, LinarLogLevel::Warning, __VA_ARGS__)
+#define LINAR_LOGI(...) LINAR_LOG_AT(*this, LinarLogLevel::Info, __VA_ARGS__)
+#define LINAR_LOGD(...) LINAR_LOG_AT(*this, LinarLogLevel::Debug, __VA_ARGS__)
+
+/**
+ * @class LinarLogRing
+ * @brief Lock-free ring buffer for deferred log output.
+ *
+ * The sink only copies the message; the slow output (UART, network) happens
+ * later in `drain()`, e.g. from `loop()`, so logging does not stretch the
+ * timing of a sweep. One task may push while another drains; several tasks
+ * logging at once need a buffer each. A message that does not fit is
+ * dropped whole and counted.
+ *
+ * @code
+ * static LinarLogRing<2048> logs;
+ * adc.debugfcn = [](const char *txt) { logs.push(txt); };
+ * ...
+ * logs.drain(Serial);
+ * @endcode
+ *
+ * @tparam Size Buffer size in bytes, a power of two.
+ */
+template <size_t Size = 1024>
+class LinarLogRing {
+public:
+    static_assert(Size > 0 && (Size & (Size - 1)) == 0, "Size must be a power of two");
+
+    /**
+     * @brief Queues a message. Producer side.
+     *
+     * @return false if it did not fit and was dropped.
+     */
+    bool push(const char *text) {
+        size_t length = strlen(text);
+        size_t writeAt = head.load(std::memory_order_relaxed);
+        size_t readAt = tail.load(std::memory_order_acquire);
+        if (length > Size - (writeAt - readAt)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        for (size_t i = 0; i < length; i++) buffer[(writeAt + i) & (Size - 1)] = text[i];
+        head.store(writeAt + length, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Writes everything queued so far to `out`. Consumer side.
+     *
+     * @return Bytes written.
+     */
+    size_t drain(Print &out) {
+        size_t readAt = tail.load(std::memory_order_relaxed);
+        size_t writeAt = head.load(std::memory_order_acquire);
+        size_t total = writeAt - readAt;
+        while (readAt != writeAt) {
+            size_t index = readAt & (Size - 1);
+            size_t chunk = min(writeAt - readAt, Size - index);
+            out.write(reinterpret_cast<const uint8_t *>(&buffer[index]), chunk);
+            readAt += chunk;
+        }
+        tail.store(readAt, std::memory_order_release);
+        return total;
+    }
+
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); } ///< Messages lost.
+
+private:
+    char buffer[Size];
+    std::atomic<size_t> head{0};        ///< Total bytes pushed.
+    std::atomic<size_t> tail{0};        ///< Total bytes drained.
+    std::atomic<uint32_t> dropped{0};
+};
@@ -0,0 +1,82 @@
+#include "LinarParallel.h"
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#else
+#include <thread>
+#include <vector>
+#endif
+
+namespace {
+
+constexpr int maxParts = 8;
+constexpr uint32_t workerStack = 4096;
+
+struct Job {
+    void (*work)(void *context, int part);
+    void *context;
+    int part;
+#ifdef ESP_PLATFORM
+    SemaphoreHandle_t done;
+#endif
+};
+
+}
+
+
+#ifdef ESP_PLATFORM
+
+int linarCoreCount() {
+    return portNUM_PROCESSORS;
+}
+
+static void worker(void *arg) {
+    Job *job = static_cast<Job *>(arg);
+    job->work(job->context, job->part);
+    xSemaphoreGive(job->done);
+    vTaskDelete(nullptr);
+}
+
+void linarParallel(int parts, void (*work)(void *context, int part), void *context) {
+    SemaphoreHandle_t done = parts > 1 ? xSemaphoreCreateCounting(maxParts, 0) : nullptr;
+    Job jobs[maxParts];
+    int started = 0;
+
+    for (int part = 1; part < parts; part++) {
+        bool running = false;
+        if (done != nullptr && part < maxParts) {
+            jobs[part] = {work, context, part, done};
+            BaseType_t core = (xPortGetCoreID() + part) % portNUM_PROCESSORS;
+            running = xTaskCreatePinnedToCore(worker, "linar_work", workerStack, &jobs[part],
+                                              uxTaskPriorityGet(nullptr), nullptr, core) == pdPASS;
+        }
+        if (running) {
+            started++;
+        } else {
+            work(context, part);
+        }
+    }
+    if (parts > 0) work(context, 0);
+
+    for (int i = 0; i < started; i++) xSemaphoreTake(done, portMAX_DELAY);
+    if (done != nullptr) vSemaphoreDelete(done);
+}
+
+#else
+
+int linarCoreCount() {
+    return max(1u, std::thread::hardware_concurrency());
+}
+
+void linarParallel(int parts, void (*work)(void *context, int part), void *context) {
+    std::vector<std::thread> threads;
+    for (int part = 1; part < min(parts, maxParts); part++) {
+        threads.emplace_back(work, context, part);
+    }
+    for (int part = maxParts; part < parts; part++) work(context, part);
+    if (parts > 0) work(context, 0);
+    for (std::thread &thread : threads) thread.join();
+}
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Number of cores work can be split across: 2 on the ESP32, 1 on single-core chips.
+ */
+int linarCoreCount();
+
+/**
+ * @brief Runs `work(context, part)` for every part in 0..parts-1 and returns when all are done.
+ *
+ * Part 0 runs on the calling task. On target the others run on short-lived
+ * FreeRTOS tasks, pinned round robin to the other cores at the caller's
+ * priority; elsewhere they run on std::thread. A part whose task cannot be
+ * started runs on the caller instead, so the work is always complete. The
+ * parts must not write to shared data.
+ */
+void linarParallel(int parts, void (*work)(void *context, int part), void *context);
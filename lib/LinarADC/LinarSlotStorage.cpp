@@ -0,0 +1,221 @@
+#include "LinarSlotStorage.h"
+#include "LinarCodec.h"
+
+
+LinarSlotStorage &LinarSlotStorage::spiffs() {
+    static LinarSlotStorage storage(LinarFsStorage::spiffs());
+    return storage;
+}
+
+String LinarSlotStorage::slotPath(const char *key, Source source) {
+    return String(key) + (source == SlotA ? ".a" : ".b");
+}
+
+bool LinarSlotStorage::readHeader(const String &path, Header &header, bool verify) {
+    const char *key = path.c_str();
+    if (storage.read(key, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != slotMagic || storage.size(key) < sizeof(header) + header.length) {
+        return false;
+    }
+    if (!verify) return true;
+
+    // Stream the payload through the CRC, a torn write never matches
+    uint8_t chunk[256];
+    uint32_t crc = 0;
+    for (size_t done = 0; done < header.length; ) {
+        size_t bytes = min(sizeof(chunk), (size_t)header.length - done);
+        if (storage.read(key, sizeof(header) + done, chunk, bytes) != bytes) return false;
+        crc = linarCrc32(chunk, bytes, crc);
+        done += bytes;
+    }
+    return crc == header.crc;
+}
+
+void LinarSlotStorage::use(Slot *slot, Source source, const Header &header, bool verified) {
+    slot->source = source;
+    slot->sequence = header.sequence;
+    slot->length = header.length;
+    slot->crc = header.crc;
+    slot->verified = verified;
+}
+
+LinarSlotStorage::Slot *LinarSlotStorage::select(const char *key) {
+    uint32_t hash = linarHash(key);
+    for (int i = 0; i < maxKeys; i++) {
+        if (slots[i].hash == hash) return &slots[i];
+    }
+
+    Slot *slot = nullptr;
+    for (int i = 0; slot == nullptr && i < maxKeys; i++) {
+        if (slots[i].hash == 0) slot = &slots[i];
+    }
+    for (int i = 0; slot == nullptr && i < maxKeys; i++) {
+        Slot &candidate = slots[nextEvict];
+        nextEvict = (nextEvict + 1) % maxKeys;
+        if (candidate.raw == nullptr) slot = &candidate;     // never drop a live mapping
+    }
+    if (slot == nullptr) return nullptr;
+
+    memset(slot, 0, sizeof(Slot));
+    slot->hash = hash;
+
+    // Headers only; the payload is checked when it is read
+    Header a, b;
+    bool validA = readHeader(slotPath(key, SlotA), a, false);
+    bool validB = readHeader(slotPath(key, SlotB), b, false);
+    if (validA && (!validB || (int32_t)(a.sequence - b.sequence) > 0)) {
+        use(slot, SlotA, a, false);
+    } else if (validB) {
+        use(slot, SlotB, b, false);
+    } else {
+        slot->length = storage.size(key);
+        slot->source = slot->length > 0 ? Plain : None;
+    }
+    return slot;
+}
+
+char LinarSlotStorage::activeSlot(const char *key) {
+    Slot *slot = select(key);
+    if (slot == nullptr || slot->source == None || slot->source == Plain) return 0;
+    return slot->source == SlotA ? 'a' : 'b';
+}
+
+size_t LinarSlotStorage::size(const char *key) {
+    Slot *slot = select(key);
+    return slot != nullptr ? slot->length : 0;
+}
+
+size_t LinarSlotStorage::read(const char *key, size_t offset, uint8_t *buffer, size_t length) {
+    Slot *slot = select(key);
+    if (slot == nullptr || slot->source == None) return 0;
+    if (slot->source == Plain) return storage.read(key, offset, buffer, length);
+
+    if (offset >= slot->length) return 0;
+    size_t bytes = min(length, slot->length - offset);
+    if (storage.read(slotPath(key, slot->source).c_str(), sizeof(Header) + offset, buffer, bytes) != bytes) return 0;
+
+    if (offset == 0 && bytes == slot->length && !slot->verified) {
+        if (linarCrc32(buffer, bytes) != slot->crc) {
+            return reject(key) ? read(key, offset, buffer, length) : 0;
+        }
+        slot->verified = true;
+    }
+    return bytes;
+}
+
+bool LinarSlotStorage::write(const char *key, const uint8_t *data, size_t length) {
+    if (strlen(key) > maxKeyLength) return false;
+    Slot *slot = select(key);
+    if (slot == nullptr) return false;
+
+    // The active slot is never touched; the other one gets the new version
+    Source target = slot->source == SlotA ? SlotB : SlotA;
+    String path = slotPath(key, target);
+    Header header = {slotMagic, slot->sequence + 1, (uint32_t)length, linarCrc32(data, length)};
+
+    uint8_t *blob = (uint8_t *)malloc(sizeof(header) + length);
+    if (blob == nullptr) return false;
+    memcpy(blob, &header, sizeof(header));
+    memcpy(blob + sizeof(header), data, length);
+    bool written = storage.write(path.c_str(), blob, sizeof(header) + length);
+    free(blob);
+
+    Header check;
+    if (!written || !readHeader(path, check, true) || check.sequence != header.sequence) return false;
+    if (slot->source == Plain && slot->raw == nullptr) storage.remove(key);   // superseded by a verified slot
+
+    use(slot, target, header, true);
+    return true;
+}
+
+bool LinarSlotStorage::writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) {
+    size_t total = size(key);
+    if (total == 0 || offset + length > total) return false;
+
+    uint8_t *blob = (uint8_t *)malloc(total);
+    if (blob == nullptr) return false;
+    bool written = read(key, 0, blob, total) == total;
+    if (written) {
+        memcpy(blob + offset, data, length);
+        written = write(key, blob, total);
+    }
+    free(blob);
+    return written;
+}
+
+bool LinarSlotStorage::remove(const char *key) {
+    bool removedA = storage.remove(slotPath(key, SlotA).c_str());
+    bool removedB = storage.remove(slotPath(key, SlotB).c_str());
+    bool removedPlain = storage.remove(key);
+
+    Slot *slot = select(key);
+    if (slot != nullptr) {
+        slot->source = None;
+        slot->length = 0;
+    }
+    return removedA || removedB || removedPlain;
+}
+
+bool LinarSlotStorage::checksum(const char *key, uint32_t &crc) {
+    Slot *slot = select(key);
+    if (slot == nullptr || (slot->source != SlotA && slot->source != SlotB)) return false;
+    crc = slot->crc;
+    return true;
+}
+
+bool LinarSlotStorage::reject(const char *key) {
+    Slot *slot = select(key);
+    if (slot == nullptr || (slot->source != SlotA && slot->source != SlotB) || slot->raw != nullptr) return false;
+
+    // The other slot only counts if its payload checks out now
+    Source other = slot->source == SlotA ? SlotB : SlotA;
+    Header header;
+    if (readHeader(slotPath(key, other), header, true) && (int32_t)(slot->sequence - header.sequence) > 0) {
+        storage.remove(slotPath(key, slot->source).c_str());    // not picked again after a reset
+        use(slot, other, header, true);
+        return true;
+    }
+    slot->source = None;
+    slot->length = 0;
+    return false;
+}
+
+const uint8_t *LinarSlotStorage::map(const char *key, size_t &length) {
+    Slot *slot = select(key);
+    if (slot == nullptr || slot->source == None || slot->raw != nullptr) return nullptr;
+
+    if (slot->source == Plain) {
+        slot->raw = storage.map(key, length);
+        slot->mapped = slot->raw;
+        return slot->mapped;
+    }
+
+    size_t total = 0;
+    const uint8_t *raw = storage.map(slotPath(key, slot->source).c_str(), total);
+    if (raw == nullptr) return nullptr;
+    if (total < sizeof(Header) + slot->length) {
+        storage.unmap(raw);
+        return nullptr;
+    }
+    slot->raw = raw;
+    slot->mapped = raw + sizeof(Header);
+    length = slot->length;
+    return slot->mapped;
+}
+
+void LinarSlotStorage::unmap(const uint8_t *data) {
+    for (int i = 0; i < maxKeys; i++) {
+        if (slots[i].raw != nullptr && slots[i].mapped == data) {
+            storage.unmap(slots[i].raw);
+            slots[i].raw = nullptr;
+            slots[i].mapped = nullptr;
+            return;
+        }
+    }
+}
+
+void LinarSlotStorage::release(const char *key) {
+    Slot *slot = select(key);
+    if (slot == nullptr || slot->source == None) return;
+    storage.release(slot->source == Plain ? key : slotPath(key, slot->source).c_str());
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <Arduino.h>
+#include "LinarStorage.h"
+
+/**
+ * @class LinarSlotStorage
+ * @brief Keeps every blob in two slots so a save never destroys the previous one.
+ *
+ * A blob stored under "/CalibrationResults.bin" lives in
+ * "/CalibrationResults.bin.a" and "/CalibrationResults.bin.b". Each slot
+ * starts with a header holding a sequence number, the payload length and its
+ * CRC-32. A write goes to the slot that is not active, is read back and
+ * checked, and only then becomes the active one; the old slot is left
+ * untouched. A brown-out during a save therefore leaves the previous
+ * calibration in place.
+ *
+ * The first access to a key reads the two slot headers and picks the one
+ * with the highest sequence; the payload is not read twice. A full `read()`
+ * checks it against the CRC, and a reader that streams it in blocks checks
+ * it with `checksum()`. Either way a slot that fails goes to `reject()`,
+ * which falls back to the other slot. When neither slot exists, the plain
+ * key is used as is, so files written before slots were introduced are
+ * still loaded.
+ *
+ * It wraps any backend; `LinarADC` uses `LinarSlotStorage::spiffs()` by
+ * default:
+ * @code
+ * LinarSlotStorage slots(LinarFsStorage::littleFs());
+ * adc.useStorage(slots);
+ * @endcode
+ */
+class LinarSlotStorage : public LinarStorage {
+public:
+    static constexpr int maxKeys = 8;   ///< Keys whose active slot is cached.
+    static constexpr size_t maxKeyLength = 29; ///< Longest key: its slot names, 2 longer, must fit SPIFFS' 31.
+
+    LinarSlotStorage(LinarStorage &backend) :storage(backend) {}
+
+    bool begin() override { return storage.begin(); }
+    size_t size(const char *key) override;
+
+    /**
+     * @brief Reads part of a blob; a read of the whole blob is checked against its CRC.
+     */
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override;
+
+    /**
+     * @brief Writes the inactive slot, verifies it, then makes it active.
+     *
+     * Fails for a key longer than `maxKeyLength`.
+     */
+    bool write(const char *key, const uint8_t *data, size_t length) override;
+
+    /**
+     * @brief Patches a blob by writing a new version of it to the other slot.
+     */
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override;
+
+    /**
+     * @brief Removes both slots and any blob stored under the plain key.
+     */
+    bool remove(const char *key) override;
+    bool checksum(const char *key, uint32_t &crc) override;
+
+    /**
+     * @brief Falls back to the other slot if it holds a valid older version.
+     *
+     * The rejected slot is then removed, so it is not picked again after a reset.
+     */
+    bool reject(const char *key) override;
+    const uint8_t *map(const char *key, size_t &length) override;
+    void unmap(const uint8_t *data) override;
+    void release(const char *key) override;
+
+    /**
+     * @brief Slot holding the current version: 'a', 'b', 0 for the plain key or none.
+     */
+    char activeSlot(const char *key);
+
+    /**
+     * @brief Slots on the shared SPIFFS storage, the default of every `LinarADC`.
+     */
+    static LinarSlotStorage &spiffs();
+
+private:
+    enum Source : uint8_t { None, SlotA, SlotB, Plain };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t length;    ///< Payload bytes after the header.
+        uint32_t crc;       ///< CRC-32 of the payload.
+    };
+    struct Slot {
+        uint32_t hash;      ///< Key hash, 0 for an unused cache entry.
+        Source source;
+        uint32_t sequence;
+        uint32_t length;
+        uint32_t crc;
+        bool verified;          ///< Payload checked against `crc`.
+        const uint8_t *mapped;  ///< Pointer handed out by `map()`.
+        const uint8_t *raw;     ///< What the backend mapped.
+    };
+    static constexpr uint32_t slotMagic = 0x544C534C; ///< "LSLT"
+
+    Slot *select(const char *key);
+    bool readHeader(const String &path, Header &header, bool verify);
+    void use(Slot *slot, Source source, const Header &header, bool verified);
+    String slotPath(const char *key, Source source);
+
+    LinarStorage &storage;
+    Slot slots[maxKeys] = {};
+    int nextEvict = 0;
+};
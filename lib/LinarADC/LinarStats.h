@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#ifdef ESP_PLATFORM
+#include <esp_cpu.h>
+#include <esp_idf_version.h>
+#else
+#include <chrono>
+#endif
+
+/**
+ * @brief Free-running cycle counter: CPU cycles on target, nanoseconds on the host.
+ */
+inline uint32_t linarCycles() {
+#ifdef ESP_PLATFORM
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    return esp_cpu_get_cycle_count();
+#else
+    return esp_cpu_get_ccount();
+#endif
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @enum LinarPhase
+ * @brief Stages of a calibration run, in order.
+ */
+enum class LinarPhase : uint8_t {
+    Sweep,          ///< DAC sweep and ADC sampling.
+    Interpolate,    ///< Filling the codes between DAC steps.
+    Invert,         ///< Turning the measured curve into the correction table.
+    Write,          ///< Encoding and storing the table.
+    Verify,         ///< Reloading the table, checking it against the DAC, writing the report.
+};
+
+/**
+ * @struct LinarPhaseStats
+ * @brief Time, samples and bytes of the last calibration run, per phase.
+ *
+ * Filled by `save()`, `saveBatch()` and `saveAtTemperature()`; compare them
+ * across firmware releases to catch regressions. Cycle counts wrap after
+ * 2^32 cycles (about 17 s at 240 MHz), which a slow sweep can exceed; the
+ * microseconds do not.
+ */
+struct LinarPhaseStats {
+    static constexpr int phaseCount = 5;
+
+    uint32_t cycles[phaseCount];    ///< CPU cycles per phase (nanoseconds on the host).
+    uint32_t micros[phaseCount];    ///< Wall time per phase.
+    uint32_t counts[phaseCount];    ///< Times each phase was timed; a batch or a recorded sweep adds more than one.
+    uint32_t samples;               ///< analogRead() calls made for this channel.
+    uint32_t bytesWritten;          ///< Bytes handed to the storage.
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    void add(LinarPhase phase, uint32_t phaseCycles, uint32_t phaseMicros) {
+        cycles[(int)phase] += phaseCycles;
+        micros[(int)phase] += phaseMicros;
+        counts[(int)phase]++;
+    }
+
+    uint32_t cyclesOf(LinarPhase phase) const { return cycles[(int)phase]; }
+    uint32_t microsOf(LinarPhase phase) const { return micros[(int)phase]; }
+    uint32_t countOf(LinarPhase phase) const { return counts[(int)phase]; }
+
+    uint32_t totalMicros() const {
+        uint32_t total = 0;
+        for (int i = 0; i < phaseCount; i++) total += micros[i];
+        return total;
+    }
+
+    static const char *phaseName(LinarPhase phase) {
+        static const char *const names[phaseCount] = {"sweep", "interpolate", "invert", "write", "verify"};
+        return names[(int)phase];
+    }
+};
+
+/**
+ * @class LinarPhaseTimer
+ * @brief Adds the time until `stop()` or the end of the scope to one phase of a `LinarPhaseStats`.
+ */
+class LinarPhaseTimer {
+public:
+    LinarPhaseTimer(LinarPhaseStats &target, LinarPhase measured)
+        :stats(target), phase(measured), startCycles(linarCycles()), startMicros(::micros()) {}
+    ~LinarPhaseTimer() { stop(); }
+
+    void stop() {
+        if (stopped) return;
+        stats.add(phase, linarCycles() - startCycles, ::micros() - startMicros);
+        stopped = true;
+    }
+
+private:
+    LinarPhaseStats &stats;
+    LinarPhase phase;
+    uint32_t startCycles;
+    uint32_t startMicros;
+    bool stopped = false;
+};
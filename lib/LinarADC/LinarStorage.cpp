@@ -0,0 +1,538 @@
+#include "LinarStorage.h"
+#include "LinarCodec.h"
+#include <nvs_flash.h>
+#include <stddef.h>
+
+
+namespace {
+
+// Holds a storage's mutex for the lifetime of the object
+class Lock {
+public:
+    Lock(SemaphoreHandle_t mutex) :held(mutex) { xSemaphoreTake(held, portMAX_DELAY); }
+    ~Lock() { xSemaphoreGive(held); }
+
+private:
+    SemaphoreHandle_t held;
+};
+
+}  // namespace
+
+uint32_t linarHash(const char *key) {
+    uint32_t hash = 2166136261u;
+    while (*key) {
+        hash ^= (uint8_t)*key++;
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;   // 0 marks a free partition extent
+}
+
+size_t LinarBuffer::write(const uint8_t *data, size_t size) {
+    if (used + size > capacity) {
+        size_t grown = capacity == 0 ? 256 : capacity;
+        while (grown < used + size) grown *= 2;
+        uint8_t *resized = (uint8_t *)realloc(buffer, grown);
+        if (resized == nullptr) return 0;
+        buffer = resized;
+        capacity = grown;
+    }
+    memcpy(buffer + used, data, size);
+    used += size;
+    return size;
+}
+
+bool LinarStorage::append(const char *key, const uint8_t *data, size_t length) {
+    size_t current = size(key);
+    uint8_t *blob = (uint8_t *)malloc(current + length);
+    if (blob == nullptr) return false;
+
+    bool written = read(key, 0, blob, current) == current;
+    if (written) {
+        memcpy(blob + current, data, length);
+        written = write(key, blob, current + length);
+    }
+    free(blob);
+    return written;
+}
+
+/* ------------------------------ Filesystem ------------------------------ */
+
+LinarFsStorage &LinarFsStorage::spiffs() {
+    static LinarFsStorage storage(LinarFsSession::spiffs());
+    return storage;
+}
+
+LinarFsStorage &LinarFsStorage::littleFs() {
+    static LinarFsStorage storage(LinarFsSession::littleFs());
+    return storage;
+}
+
+LinarFsStorage::LinarFsStorage(LinarFsSession &fsSession) :session(fsSession) {
+    mutex = xSemaphoreCreateMutex();
+}
+
+LinarFsStorage::~LinarFsStorage() {
+    reader.close();
+    vSemaphoreDelete(mutex);
+}
+
+size_t LinarFsStorage::size(const char *key) {
+    if (!session.fs().exists(key)) return 0;
+    File file = session.fs().open(key, FILE_READ);
+    if (!file || file.isDirectory()) return 0;
+    size_t bytes = file.size();
+    file.close();
+    return bytes;
+}
+
+size_t LinarFsStorage::read(const char *key, size_t offset, uint8_t *buffer, size_t length) {
+    Lock lock(mutex);
+    if (!reader || readerKey != key || !session.isMounted()) {
+        reader.close();
+        reader = session.fs().open(key, FILE_READ);
+        readerKey = key;
+        if (!reader || reader.isDirectory()) {
+            reader.close();
+            return 0;
+        }
+    }
+    size_t bytes = reader.seek(offset) ? reader.read(buffer, length) : 0;
+    if (bytes < length || offset + bytes >= reader.size()) reader.close();   // done with this file
+    return bytes;
+}
+
+void LinarFsStorage::release(const char *key) {
+    Lock lock(mutex);
+    if (readerKey == key) reader.close();
+}
+
+void LinarFsStorage::closeReader() {
+    Lock lock(mutex);
+    reader.close();
+}
+
+bool LinarFsStorage::write(const char *key, const uint8_t *data, size_t length) {
+    closeReader();
+    File file = session.fs().open(key, FILE_WRITE);
+    if (!file) return false;
+    bool written = file.write(data, length) == length;
+    file.close();
+    return written;
+}
+
+bool LinarFsStorage::writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) {
+    closeReader();
+    File file = session.fs().open(key, "r+");
+    if (!file) return false;
+    bool written = file.seek(offset) && file.write(data, length) == length;
+    file.close();
+    return written;
+}
+
+bool LinarFsStorage::append(const char *key, const uint8_t *data, size_t length) {
+    closeReader();
+    File file = session.fs().open(key, FILE_APPEND);
+    if (!file) return false;
+    bool written = file.write(data, length) == length;
+    file.close();
+    return written;
+}
+
+bool LinarFsStorage::remove(const char *key) {
+    closeReader();
+    return session.fs().remove(key);
+}
+
+/* ---------------------------------- NVS --------------------------------- */
+
+LinarNvsStorage::LinarNvsStorage(const char *nvsNamespace) :name(nvsNamespace) {
+    mutex = xSemaphoreCreateMutex();
+}
+
+LinarNvsStorage::~LinarNvsStorage() {
+    if (opened) nvs_close(handle);
+    free(cached);
+    vSemaphoreDelete(mutex);
+}
+
+bool LinarNvsStorage::begin() {
+    if (opened) return true;
+    nvs_flash_init();    // already done by the Arduino core, harmless to repeat
+    opened = nvs_open(name, NVS_READWRITE, &handle) == ESP_OK;
+    return opened;
+}
+
+void LinarNvsStorage::hashKey(const char *key, char *nvsKey) {
+    snprintf(nvsKey, 16, "k%08lx", (unsigned long)linarHash(key));
+}
+
+size_t LinarNvsStorage::size(const char *key) {
+    char nvsKey[16];
+    size_t bytes = 0;
+    hashKey(key, nvsKey);
+    if (nvs_get_blob(handle, nvsKey, nullptr, &bytes) != ESP_OK) return 0;
+    return bytes;
+}
+
+size_t LinarNvsStorage::read(const char *key, size_t offset, uint8_t *buffer, size_t length) {
+    Lock lock(mutex);
+    char nvsKey[16];
+    hashKey(key, nvsKey);
+
+    if (cached == nullptr || strcmp(cachedKey, nvsKey) != 0) {
+        size_t total = 0;
+        if (nvs_get_blob(handle, nvsKey, nullptr, &total) != ESP_OK || offset >= total) return 0;
+        dropCache();
+
+        // NVS only reads whole blobs: go straight to the caller's buffer when it fits
+        if (offset == 0 && length >= total) {
+            return nvs_get_blob(handle, nvsKey, buffer, &total) == ESP_OK ? total : 0;
+        }
+
+        // Otherwise keep the blob for the blocks that follow
+        cached = (uint8_t *)malloc(total);
+        if (cached == nullptr) return 0;
+        if (nvs_get_blob(handle, nvsKey, cached, &total) != ESP_OK) {
+            dropCache();
+            return 0;
+        }
+        cachedLength = total;
+        strcpy(cachedKey, nvsKey);
+    }
+
+    if (offset >= cachedLength) return 0;
+    size_t bytes = min(length, cachedLength - offset);
+    memcpy(buffer, cached + offset, bytes);
+    if (offset + bytes == cachedLength) dropCache();    // last block, the copy is not needed
+    return bytes;
+}
+
+void LinarNvsStorage::release(const char *key) {
+    Lock lock(mutex);
+    char nvsKey[16];
+    hashKey(key, nvsKey);
+    if (strcmp(cachedKey, nvsKey) == 0) dropCache();
+}
+
+void LinarNvsStorage::dropCache() {
+    free(cached);
+    cached = nullptr;
+    cachedLength = 0;
+    cachedKey[0] = '\0';
+}
+
+bool LinarNvsStorage::write(const char *key, const uint8_t *data, size_t length) {
+    Lock lock(mutex);
+    char nvsKey[16];
+    hashKey(key, nvsKey);
+    dropCache();
+    return nvs_set_blob(handle, nvsKey, data, length) == ESP_OK && nvs_commit(handle) == ESP_OK;
+}
+
+bool LinarNvsStorage::writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) {
+    size_t total = size(key);
+    if (offset + length > total) return false;
+
+    uint8_t *blob = (uint8_t *)malloc(total);
+    if (blob == nullptr) return false;
+    bool written = read(key, 0, blob, total) == total;
+    if (written) {
+        memcpy(blob + offset, data, length);
+        written = write(key, blob, total);
+    }
+    free(blob);
+    return written;
+}
+
+bool LinarNvsStorage::remove(const char *key) {
+    Lock lock(mutex);
+    char nvsKey[16];
+    hashKey(key, nvsKey);
+    dropCache();
+    return nvs_erase_key(handle, nvsKey) == ESP_OK && nvs_commit(handle) == ESP_OK;
+}
+
+/* ------------------------------- Partition ------------------------------ */
+
+bool LinarPartitionStorage::begin() {
+    if (partition != nullptr) return true;
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == nullptr) return false;
+
+    // Two copies of the directory; the valid one with the higher sequence is current
+    bool found = false;
+    for (int s = 0; s < directorySectors; s++) {
+        Directory copy;
+        if (esp_partition_read(partition, s * sectorSize, &copy, sizeof(copy)) != ESP_OK ||
+            copy.magic != directoryMagic || copy.count > maxEntries ||
+            copy.crc != linarCrc32((const uint8_t *)&copy, offsetof(Directory, crc))) {
+            continue;       // blank, or torn by a reset during its write
+        }
+        if (found && (int32_t)(copy.sequence - directory.sequence) <= 0) continue;
+        directory = copy;
+        directorySector = s;
+        found = true;
+    }
+    if (!found) {
+        memset(&directory, 0, sizeof(directory));      // blank partition, written on first save
+        directory.magic = directoryMagic;
+        directorySector = directorySectors - 1;
+    }
+    return true;
+}
+
+LinarPartitionStorage::Entry *LinarPartitionStorage::find(uint32_t hash) {
+    for (uint32_t i = 0; i < directory.count; i++) {
+        if (directory.entries[i].hash == hash) return &directory.entries[i];
+    }
+    return nullptr;
+}
+
+bool LinarPartitionStorage::writeDirectory() {
+    // Only the older copy is erased, so a reset here leaves the current one readable
+    int target = (directorySector + 1) % directorySectors;
+    directory.sequence++;
+    directory.crc = linarCrc32((const uint8_t *)&directory, offsetof(Directory, crc));
+    if (esp_partition_erase_range(partition, target * sectorSize, sectorSize) != ESP_OK ||
+        esp_partition_write(partition, target * sectorSize, &directory, sizeof(directory)) != ESP_OK) {
+        return false;
+    }
+    directorySector = target;
+    return true;
+}
+
+size_t LinarPartitionStorage::size(const char *key) {
+    Entry *entry = find(linarHash(key));
+    return entry != nullptr ? entry->length : 0;
+}
+
+size_t LinarPartitionStorage::read(const char *key, size_t offset, uint8_t *buffer, size_t length) {
+    Entry *entry = find(linarHash(key));
+    if (entry == nullptr || offset >= entry->length) return 0;
+    size_t bytes = min(length, entry->length - offset);
+    return esp_partition_read(partition, entry->offset + offset, buffer, bytes) == ESP_OK ? bytes : 0;
+}
+
+int LinarPartitionStorage::freeExtent(size_t length) {
+    size_t needed = (length + sectorSize - 1) / sectorSize * sectorSize;
+    for (uint32_t i = 0; i < directory.count; i++) {
+        const Entry &entry = directory.entries[i];
+        if (entry.hash == 0 && entry.capacity >= needed && !mapped(entry.offset)) return i;
+    }
+
+    // None large enough: a new extent after the last one, counted once it is committed
+    if (directory.count == maxEntries) return -1;
+    uint32_t end = directorySectors * sectorSize;
+    for (uint32_t i = 0; i < directory.count; i++) {
+        end = max(end, directory.entries[i].offset + directory.entries[i].capacity);
+    }
+    if (end + needed > partition->size) return -1;
+    Entry &entry = directory.entries[directory.count];
+    entry.hash = 0;
+    entry.offset = end;
+    entry.length = 0;
+    entry.capacity = needed;
+    return directory.count;
+}
+
+bool LinarPartitionStorage::commit(int extent, uint32_t hash, size_t length) {
+    Directory previous = directory;
+    Entry *old = find(hash);
+    if (old != nullptr) {
+        old->hash = 0;              // freed, its data stays until the extent is reused
+        old->length = 0;
+    }
+    if (extent == (int)directory.count) directory.count++;
+    directory.entries[extent].hash = hash;
+    directory.entries[extent].length = length;
+    if (writeDirectory()) return true;
+    directory = previous;           // flash still holds the previous directory
+    return false;
+}
+
+bool LinarPartitionStorage::mapped(uint32_t offset) {
+    for (int i = 0; i < maxEntries; i++) {
+        if (mappings[i].data != nullptr && mappings[i].offset == offset) return true;
+    }
+    return false;
+}
+
+bool LinarPartitionStorage::write(const char *key, const uint8_t *data, size_t length) {
+    // Never in place: the new version goes to a free extent, then the directory switches to it
+    int extent = freeExtent(length);
+    if (extent < 0) return false;
+    // The whole extent is erased, so append() can fill its tail later
+    const Entry &target = directory.entries[extent];
+    return esp_partition_erase_range(partition, target.offset, target.capacity) == ESP_OK &&
+           esp_partition_write(partition, target.offset, data, length) == ESP_OK &&
+           commit(extent, linarHash(key), length);
+}
+
+bool LinarPartitionStorage::writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) {
+    Entry *entry = find(linarHash(key));
+    if (entry == nullptr || offset + length > entry->length) return false;
+
+    // Flash only clears bits, and erasing in place would lose the blob on a reset:
+    // copy it sector by sector to a free extent with the patch applied, then switch
+    int extent = freeExtent(entry->length);
+    if (extent < 0) return false;
+    uint8_t *sector = (uint8_t *)malloc(sectorSize);
+    if (sector == nullptr) return false;
+
+    const Entry &target = directory.entries[extent];
+    bool written = esp_partition_erase_range(partition, target.offset, target.capacity) == ESP_OK;
+    size_t end = offset + length;
+    for (size_t base = 0; written && base < entry->length; base += sectorSize) {
+        size_t bytes = min((size_t)sectorSize, entry->length - base);
+        written = esp_partition_read(partition, entry->offset + base, sector, bytes) == ESP_OK;
+        if (offset < base + bytes && end > base) {
+            size_t from = max(offset, base);
+            size_t to = min(end, base + bytes);
+            memcpy(sector + (from - base), data + (from - offset), to - from);
+        }
+        written = written && esp_partition_write(partition, target.offset + base, sector, bytes) == ESP_OK;
+    }
+    free(sector);
+    return written && commit(extent, entry->hash, entry->length);
+}
+
+bool LinarPartitionStorage::append(const char *key, const uint8_t *data, size_t length) {
+    Entry *entry = find(linarHash(key));
+
+    // The tail of an extent stays erased after write(), so it can be filled without erasing
+    if (entry == nullptr || entry->length + length > entry->capacity) {
+        return LinarStorage::append(key, data, length);
+    }
+    if (esp_partition_write(partition, entry->offset + entry->length, data, length) != ESP_OK) return false;
+    entry->length += length;
+    return writeDirectory();
+}
+
+bool LinarPartitionStorage::remove(const char *key) {
+    Entry *entry = find(linarHash(key));
+    if (entry == nullptr) return false;
+    entry->hash = 0;
+    entry->length = 0;
+    return writeDirectory();
+}
+
+const uint8_t *LinarPartitionStorage::map(const char *key, size_t &length) {
+    Entry *entry = find(linarHash(key));
+    if (entry == nullptr) return nullptr;
+
+    for (int i = 0; i < maxEntries; i++) {
+        if (mappings[i].data != nullptr) continue;
+        const void *data;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        esp_partition_mmap_memory_t memory = ESP_PARTITION_MMAP_DATA;
+#else
+        spi_flash_mmap_memory_t memory = SPI_FLASH_MMAP_DATA;
+#endif
+        if (esp_partition_mmap(partition, entry->offset, entry->length, memory, &data, &mappings[i].handle) != ESP_OK) {
+            return nullptr;
+        }
+        mappings[i].data = data;
+        mappings[i].offset = entry->offset;
+        length = entry->length;
+        return (const uint8_t *)data;
+    }
+    return nullptr;
+}
+
+void LinarPartitionStorage::unmap(const uint8_t *data) {
+    for (int i = 0; i < maxEntries; i++) {
+        if (mappings[i].data == data) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+            esp_partition_munmap(mappings[i].handle);
+#else
+            spi_flash_munmap(mappings[i].handle);
+#endif
+            mappings[i].data = nullptr;
+            return;
+        }
+    }
+}
+
+/* ---------------------------------- RAM --------------------------------- */
+
+LinarRamStorage::~LinarRamStorage() {
+    for (int i = 0; i < maxEntries; i++) free(entries[i].data);
+}
+
+LinarRamStorage::Entry *LinarRamStorage::find(const char *key) {
+    for (int i = 0; i < maxEntries; i++) {
+        if (entries[i].data != nullptr && entries[i].key == key) return &entries[i];
+    }
+    return nullptr;
+}
+
+size_t LinarRamStorage::size(const char *key) {
+    Entry *entry = find(key);
+    return entry != nullptr ? entry->length : 0;
+}
+
+size_t LinarRamStorage::read(const char *key, size_t offset, uint8_t *buffer, size_t length) {
+    Entry *entry = find(key);
+    if (entry == nullptr || offset >= entry->length) return 0;
+    size_t bytes = min(length, entry->length - offset);
+    memcpy(buffer, entry->data + offset, bytes);
+    return bytes;
+}
+
+bool LinarRamStorage::write(const char *key, const uint8_t *data, size_t length) {
+    Entry *entry = find(key);
+    for (int i = 0; entry == nullptr && i < maxEntries; i++) {
+        if (entries[i].data == nullptr) entry = &entries[i];
+    }
+    if (entry == nullptr) return false;
+
+    bool powerLoss = powerLossAfter >= 0;
+    if (powerLoss) {
+        length = min(length, (size_t)powerLossAfter);
+        powerLossAfter = -1;
+    }
+
+    uint8_t *copy = (uint8_t *)malloc(length > 0 ? length : 1);
+    if (copy == nullptr) return false;
+    memcpy(copy, data, length);
+    free(entry->data);
+    entry->key = key;
+    entry->data = copy;
+    entry->length = length;
+    return !powerLoss;
+}
+
+bool LinarRamStorage::writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) {
+    Entry *entry = find(key);
+    if (entry == nullptr || offset + length > entry->length) return false;
+    memcpy(entry->data + offset, data, length);
+    return true;
+}
+
+bool LinarRamStorage::append(const char *key, const uint8_t *data, size_t length) {
+    Entry *entry = find(key);
+    if (entry == nullptr) return write(key, data, length);
+
+    uint8_t *resized = (uint8_t *)realloc(entry->data, entry->length + length);
+    if (resized == nullptr) return false;
+    memcpy(resized + entry->length, data, length);
+    entry->data = resized;
+    entry->length += length;
+    return true;
+}
+
+bool LinarRamStorage::remove(const char *key) {
+    Entry *entry = find(key);
+    if (entry == nullptr) return false;
+    free(entry->data);
+    entry->data = nullptr;
+    entry->length = 0;
+    return true;
+}
+
+const uint8_t *LinarRamStorage::map(const char *key, size_t &length) {
+    Entry *entry = find(key);
+    if (entry == nullptr) return nullptr;
+    length = entry->length;
+    return entry->data;
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <Arduino.h>
+#include <nvs.h>
+#include <esp_partition.h>
+#include <esp_idf_version.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "LinarFsSession.h"
+
+/**
+ * @class LinarStorage
+ * @brief Where `LinarADC` keeps its calibration data.
+ *
+ * A storage holds byte blobs addressed by key (the file path, e.g.
+ * "/CalibrationResults.bin"). The file formats (".txt", ".json", ".bin",
+ * ".temp", the report) are encoded and decoded by `LinarADC` the same way
+ * for every backend; a backend only moves bytes.
+ *
+ * Backends:
+ * - `LinarFsStorage`: files on SPIFFS or LittleFS through a `LinarFsSession`.
+ * - `LinarNvsStorage`: blobs in an NVS namespace.
+ * - `LinarPartitionStorage`: a raw data partition.
+ * - `LinarRamStorage`: heap only, for tests and host builds.
+ *
+ * `LinarSlotStorage` wraps any of them to make saves power-fail safe.
+ *
+ * Example usage:
+ * @code
+ * LinarPartitionStorage storage("calib"); // data partition labelled "calib"
+ * LinarADC adc;
+ * adc.useStorage(storage);
+ * adc.begin();
+ * @endcode
+ */
+class LinarStorage {
+public:
+    virtual ~LinarStorage() {}
+
+    /**
+     * @brief Makes the storage ready. Cheap to call again once it succeeded.
+     */
+    virtual bool begin() = 0;
+
+    /**
+     * @brief Size of a blob in bytes, 0 if it does not exist.
+     */
+    virtual size_t size(const char *key) = 0;
+
+    /**
+     * @brief Reads part of a blob.
+     *
+     * @return Bytes copied to `buffer`, less than `length` at the end of the blob.
+     */
+    virtual size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) = 0;
+
+    /**
+     * @brief Replaces a blob with `length` bytes.
+     */
+    virtual bool write(const char *key, const uint8_t *data, size_t length) = 0;
+
+    /**
+     * @brief Overwrites part of an existing blob in place without resizing it.
+     *
+     * A reset during the call may lose the new bytes, but must leave the rest
+     * of the blob intact. `LinarTableStore` relies on this for its index.
+     */
+    virtual bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) = 0;
+
+    /**
+     * @brief Adds bytes to the end of a blob, creating it if needed.
+     *
+     * The default reads the blob and writes it back; backends override it
+     * when they can extend a blob in place.
+     */
+    virtual bool append(const char *key, const uint8_t *data, size_t length);
+
+    virtual bool remove(const char *key) = 0;
+
+    /**
+     * @brief CRC-32 recorded for a blob, for backends that keep one.
+     *
+     * Lets a reader that streams a blob in blocks check it in the same pass.
+     */
+    virtual bool checksum(const char *key, uint32_t &crc) { return false; }
+
+    /**
+     * @brief Drops the current version of a blob that failed validation.
+     *
+     * @return true if an older version is available and is now returned instead.
+     */
+    virtual bool reject(const char *key) { return false; }
+
+    /**
+     * @brief Frees what the backend keeps between the block reads of a blob.
+     *
+     * Readers call it when they stop reading a blob, at its end or not.
+     */
+    virtual void release(const char *key) {}
+
+    /**
+     * @brief Maps a blob into the address space for zero-copy reads.
+     *
+     * @param length Receives the blob size.
+     * @return Pointer valid until `unmap()` or the next write of the blob,
+     *         nullptr if the backend cannot map.
+     */
+    virtual const uint8_t *map(const char *key, size_t &length) { return nullptr; }
+
+    /**
+     * @brief Releases a pointer returned by `map()`.
+     */
+    virtual void unmap(const uint8_t *data) {}
+};
+
+/**
+ * @class LinarBuffer
+ * @brief Growable byte buffer used to encode a blob before it is written.
+ */
+class LinarBuffer : public Print {
+public:
+    ~LinarBuffer() { free(buffer); }
+
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+
+    const uint8_t *data() const { return buffer; }
+    size_t length() const { return used; }
+
+private:
+    uint8_t *buffer = nullptr;
+    size_t used = 0;
+    size_t capacity = 0;
+};
+
+/**
+ * @class LinarFsStorage
+ * @brief Blobs stored as files on a filesystem session (SPIFFS, LittleFS).
+ *
+ * A file being read in blocks stays open from one block to the next and is
+ * closed once its end is read, or when any file is written or removed.
+ */
+class LinarFsStorage : public LinarStorage {
+public:
+    LinarFsStorage(LinarFsSession &fsSession);
+    ~LinarFsStorage();
+
+    bool begin() override { return session.mount(); }
+    size_t size(const char *key) override;
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *key, const uint8_t *data, size_t length) override;
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override;
+    bool append(const char *key, const uint8_t *data, size_t length) override;
+    bool remove(const char *key) override;
+    void release(const char *key) override;
+
+    /**
+     * @brief Storage on the shared SPIFFS session, the default of every `LinarADC`.
+     */
+    static LinarFsStorage &spiffs();
+
+    /**
+     * @brief Storage on the shared LittleFS session.
+     */
+    static LinarFsStorage &littleFs();
+
+private:
+    void closeReader();
+
+    LinarFsSession &session;
+    SemaphoreHandle_t mutex;
+    File reader;                ///< File of the last partial read, still open.
+    String readerKey;
+};
+
+/**
+ * @class LinarNvsStorage
+ * @brief Blobs stored in an NVS namespace.
+ *
+ * NVS keys are limited to 15 characters, so each path is stored under a
+ * hash of it. Whole blobs are read straight into the caller's buffer.
+ *
+ * NVS cannot read part of a blob, so a partial read fetches the whole blob
+ * once and serves the following blocks from that copy. The copy is freed
+ * when the end of the blob is read, or on any write.
+ */
+class LinarNvsStorage : public LinarStorage {
+public:
+    LinarNvsStorage(const char *nvsNamespace = "linaradc");
+    ~LinarNvsStorage();
+
+    bool begin() override;
+    size_t size(const char *key) override;
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *key, const uint8_t *data, size_t length) override;
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override;
+    bool remove(const char *key) override;
+    void release(const char *key) override;
+
+private:
+    void hashKey(const char *key, char *nvsKey);
+    void dropCache();
+
+    const char *name;
+    nvs_handle_t handle = 0;
+    bool opened = false;
+    SemaphoreHandle_t mutex;
+    uint8_t *cached = nullptr;  ///< Blob of the last partial read.
+    size_t cachedLength = 0;
+    char cachedKey[16] = "";
+};
+
+/**
+ * @class LinarPartitionStorage
+ * @brief Blobs stored in a raw data partition, without a filesystem.
+ *
+ * The first two sectors hold two copies of a small directory, each with a
+ * sequence number and a CRC. An update erases and rewrites only the older
+ * copy, so a reset at any point leaves a valid directory. Every blob gets its
+ * own run of sectors. A write never erases the current version: it goes to
+ * a free run large enough, and only the directory update makes it current,
+ * so a reset during a write leaves the previous version in place.
+ * `writeAt()` works the same way on a copy of the blob, and `append()` only
+ * fills the erased tail of the run. Runs that are mapped are not reused.
+ * Reads go straight from flash into the caller's buffer, and `map()` maps a
+ * blob through the flash cache with `esp_partition_mmap`, so a ".bin" table
+ * is used in place without copying it to the heap.
+ *
+ * Add a data partition to the partition table, e.g.
+ * `calib, data, 0x40, , 0x20000,`
+ */
+class LinarPartitionStorage : public LinarStorage {
+public:
+    static constexpr int maxEntries = 16;           ///< Blobs per partition.
+    static constexpr size_t sectorSize = 4096;      ///< Flash erase unit.
+
+    LinarPartitionStorage(const char *partitionLabel) :label(partitionLabel) {}
+
+    bool begin() override;
+    size_t size(const char *key) override;
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *key, const uint8_t *data, size_t length) override;
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override;
+    bool append(const char *key, const uint8_t *data, size_t length) override;
+    bool remove(const char *key) override;
+    const uint8_t *map(const char *key, size_t &length) override;
+    void unmap(const uint8_t *data) override;
+
+private:
+    struct Mapping {
+        const void *data;
+        uint32_t offset;    ///< Extent the mapping covers.
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        esp_partition_mmap_handle_t handle;
+#else
+        spi_flash_mmap_handle_t handle;     // IDF 4.4 of the Arduino-ESP32 2.x core
+#endif
+    };
+
+    struct Entry {
+        uint32_t hash;      ///< FNV-1a of the key, 0 for a free extent.
+        uint32_t offset;    ///< Start of the extent, sector aligned.
+        uint32_t length;    ///< Bytes in use.
+        uint32_t capacity;  ///< Extent size, whole sectors.
+    };
+    struct Directory {
+        uint32_t magic;
+        uint32_t sequence;  ///< Higher in the newer of the two copies.
+        uint32_t count;
+        Entry entries[maxEntries];
+        uint32_t crc;       ///< CRC-32 of the fields above.
+    };
+    static constexpr uint32_t directoryMagic = 0x3254504C; ///< "LPT2"
+    static constexpr int directorySectors = 2;             ///< Copies of the directory, one per sector.
+
+    Entry *find(uint32_t hash);
+    bool writeDirectory();
+    int freeExtent(size_t length);      ///< Free extent for `length` bytes, -1 if none.
+    bool commit(int extent, uint32_t hash, size_t length);
+    bool mapped(uint32_t offset);
+
+    const char *label;
+    const esp_partition_t *partition = nullptr;
+    Directory directory;
+    int directorySector = 0;    ///< Sector of the current directory copy.
+    Mapping mappings[maxEntries] = {};
+};
+
+/**
+ * @class LinarRamStorage
+ * @brief Blobs kept on the heap. Nothing survives a reset.
+ *
+ * Meant for tests and host builds, or to hold a table received at runtime.
+ * `map()` returns the heap copy itself.
+ */
+class LinarRamStorage : public LinarStorage {
+public:
+    static constexpr int maxEntries = 8;
+
+    ~LinarRamStorage();
+
+    bool begin() override { return true; }
+    size_t size(const char *key) override;
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *key, const uint8_t *data, size_t length) override;
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override;
+    bool append(const char *key, const uint8_t *data, size_t length) override;
+    bool remove(const char *key) override;
+    const uint8_t *map(const char *key, size_t &length) override;
+
+    /**
+     * @brief Simulates a power loss during the next `write()`.
+     *
+     * Only the first `bytes` bytes of that write are stored and it returns
+     * false, as if the device reset part way through. Stepping `bytes` over
+     * every offset checks that a save can be interrupted anywhere.
+     */
+    void failNextWrite(size_t bytes) { powerLossAfter = bytes; }
+
+private:
+    struct Entry {
+        String key;
+        uint8_t *data = nullptr;
+        size_t length = 0;
+    };
+
+    Entry *find(const char *key);
+
+    Entry entries[maxEntries];
+    long powerLossAfter = -1;
+};
+
+/**
+ * @brief 32-bit FNV-1a hash, used to derive fixed-size keys.
+ */
+uint32_t linarHash(const char *key);
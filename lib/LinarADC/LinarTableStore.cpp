@@ -0,0 +1,285 @@
+#include "LinarTableStore.h"
+#include "LinarCodec.h"
+#include <stddef.h>
+
+
+namespace {
+
+// Holds the store's mutex for the lifetime of the object
+class Lock {
+public:
+    Lock(SemaphoreHandle_t mutex) :held(mutex) { xSemaphoreTake(held, portMAX_DELAY); }
+    ~Lock() { xSemaphoreGive(held); }
+
+private:
+    SemaphoreHandle_t held;
+};
+
+}  // namespace
+
+LinarTableStore::LinarTableStore(LinarStorage &backend, const char *path)
+    :storage(backend), containerPath(path) {
+    mutex = xSemaphoreCreateMutex();
+    memset(entries, 0, sizeof(entries));
+    memset(hashes, 0, sizeof(hashes));
+}
+
+LinarTableStore::~LinarTableStore() {
+    vSemaphoreDelete(mutex);
+}
+
+bool LinarTableStore::begin() {
+    Lock lock(mutex);
+    if (loaded) return true;
+    if (!storage.begin()) return false;
+
+    memset(entries, 0, sizeof(entries));
+    memset(hashes, 0, sizeof(hashes));
+    end = storage.size(containerPath);
+
+    if (end == 0) {
+        // New container: header and an empty index
+        uint8_t *blank = (uint8_t *)calloc(1, dataStart);
+        if (blank == nullptr) return false;
+        Header header = {storeMagic, 1, capacity};
+        memcpy(blank, &header, sizeof(header));
+        loaded = storage.write(containerPath, blank, dataStart);
+        free(blank);
+        end = dataStart;
+        return loaded;
+    }
+
+    Header header;
+    if (storage.read(containerPath, 0, (uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != storeMagic || header.slots != capacity ||
+        storage.read(containerPath, sizeof(header), (uint8_t *)entries, sizeof(entries)) != sizeof(entries)) {
+        return false;    // not ours, leave it alone
+    }
+
+    for (int i = 0; i < capacity; i++) {
+        Entry &entry = entries[i];
+        entry.key[maxKeyLength] = '\0';
+        bool valid = entry.key[0] != '\0' &&
+                     entry.entryCrc == linarCrc32((const uint8_t *)&entry, offsetof(Entry, entryCrc)) &&
+                     entry.offset >= dataStart && entry.offset + entry.length <= end;
+        if (!valid) {
+            memset(&entry, 0, sizeof(entry));       // torn or stale, the slot is free
+            continue;
+        }
+        hashes[i] = linarHash(entry.key);
+        nextSequence = max(nextSequence, entry.sequence + 1);
+    }
+
+    // An update interrupted before the old entry was freed leaves two; keep the newer
+    for (int i = 0; i < capacity; i++) {
+        for (int j = i + 1; j < capacity && hashes[i] != 0; j++) {
+            if (hashes[j] != hashes[i] || strcmp(entries[i].key, entries[j].key) != 0) continue;
+            int stale = entries[i].sequence < entries[j].sequence ? i : j;
+            memset(&entries[stale], 0, sizeof(Entry));
+            hashes[stale] = 0;
+        }
+    }
+
+    loaded = true;
+    return true;
+}
+
+int LinarTableStore::find(const char *key) {
+    uint32_t hash = linarHash(key);
+    for (int i = 0; i < capacity; i++) {
+        if (hashes[i] == hash && strcmp(entries[i].key, key) == 0) return i;
+    }
+    return -1;
+}
+
+int LinarTableStore::freeSlot() {
+    for (int i = 0; i < capacity; i++) {
+        if (entries[i].key[0] == '\0') return i;
+    }
+    return -1;
+}
+
+int LinarTableStore::freeSlots() {
+    int unused = 0;
+    for (int i = 0; i < capacity; i++) {
+        if (entries[i].key[0] == '\0') unused++;
+    }
+    return unused;
+}
+
+bool LinarTableStore::writeEntry(int slot, const Entry &entry) {
+    return storage.writeAt(containerPath, sizeof(Header) + slot * sizeof(Entry),
+                           (const uint8_t *)&entry, sizeof(Entry));
+}
+
+bool LinarTableStore::storeLocked(const char *key, const uint8_t *data, size_t length) {
+    if (!loaded || strlen(key) > maxKeyLength) return false;
+
+    // A new key may not take the last free slot: every update needs one
+    int old = find(key);
+    int slot = freeSlot();
+    if (slot < 0 || (old < 0 && freeSlots() < 2)) return false;
+
+    // 1. the data, after everything else
+    uint32_t offset = end;
+    if (length > 0 && !storage.append(containerPath, data, length)) {
+        end = storage.size(containerPath);
+        return false;
+    }
+    end += length;
+
+    // 2. the new entry, in a free slot
+    Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.key, key, maxKeyLength);
+    entry.offset = offset;
+    entry.length = length;
+    entry.crc = linarCrc32(data, length);
+    entry.sequence = nextSequence++;
+    entry.entryCrc = linarCrc32((const uint8_t *)&entry, offsetof(Entry, entryCrc));
+    if (!writeEntry(slot, entry)) return false;
+    entries[slot] = entry;
+    hashes[slot] = linarHash(key);
+
+    // 3. the old entry; if this is lost, begin() still prefers the newer one
+    if (old >= 0) {
+        Entry blank;
+        memset(&blank, 0, sizeof(blank));
+        writeEntry(old, blank);
+        entries[old] = blank;
+        hashes[old] = 0;
+    }
+    return true;
+}
+
+size_t LinarTableStore::size(const char *key) {
+    Lock lock(mutex);
+    int slot = find(key);
+    return slot >= 0 ? entries[slot].length : 0;
+}
+
+size_t LinarTableStore::read(const char *key, size_t offset, uint8_t *buffer, size_t length) {
+    Lock lock(mutex);
+    int slot = find(key);
+    if (slot < 0 || offset >= entries[slot].length) return 0;
+
+    const Entry &entry = entries[slot];
+    size_t bytes = min(length, entry.length - offset);
+    if (storage.read(containerPath, entry.offset + offset, buffer, bytes) != bytes) return 0;
+    if (offset == 0 && bytes == entry.length && linarCrc32(buffer, bytes) != entry.crc) return 0;
+    return bytes;
+}
+
+bool LinarTableStore::write(const char *key, const uint8_t *data, size_t length) {
+    Lock lock(mutex);
+    return storeLocked(key, data, length);
+}
+
+bool LinarTableStore::writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) {
+    Lock lock(mutex);
+    int slot = find(key);
+    if (slot < 0 || offset + length > entries[slot].length) return false;
+
+    size_t total = entries[slot].length;
+    uint8_t *table = (uint8_t *)malloc(total);
+    if (table == nullptr) return false;
+    bool written = storage.read(containerPath, entries[slot].offset, table, total) == total;
+    if (written) {
+        memcpy(table + offset, data, length);
+        written = storeLocked(key, table, total);
+    }
+    free(table);
+    return written;
+}
+
+bool LinarTableStore::append(const char *key, const uint8_t *data, size_t length) {
+    Lock lock(mutex);
+    int slot = find(key);
+    if (slot < 0) return storeLocked(key, data, length);
+
+    size_t current = entries[slot].length;
+    uint8_t *table = (uint8_t *)malloc(current + length);
+    if (table == nullptr) return false;
+    bool written = storage.read(containerPath, entries[slot].offset, table, current) == current;
+    if (written) {
+        memcpy(table + current, data, length);
+        written = storeLocked(key, table, current + length);
+    }
+    free(table);
+    return written;
+}
+
+bool LinarTableStore::remove(const char *key) {
+    Lock lock(mutex);
+    int slot = find(key);
+    if (slot < 0) return false;
+
+    Entry blank;
+    memset(&blank, 0, sizeof(blank));
+    if (!writeEntry(slot, blank)) return false;
+    entries[slot] = blank;
+    hashes[slot] = 0;
+    return true;
+}
+
+bool LinarTableStore::checksum(const char *key, uint32_t &crc) {
+    Lock lock(mutex);
+    int slot = find(key);
+    if (slot < 0) return false;
+    crc = entries[slot].crc;
+    return true;
+}
+
+void LinarTableStore::release(const char *key) {
+    storage.release(containerPath);
+}
+
+bool LinarTableStore::compact() {
+    Lock lock(mutex);
+    if (!loaded) return false;
+
+    size_t live = dataStart;
+    for (int i = 0; i < capacity; i++) live += entries[i].length;
+
+    uint8_t *image = (uint8_t *)calloc(1, live);
+    if (image == nullptr) return false;
+
+    Header header = {storeMagic, 1, capacity};
+    Entry compacted[capacity];
+    memcpy(image, &header, sizeof(header));
+    memcpy(compacted, entries, sizeof(entries));
+
+    bool copied = true;
+    size_t offset = dataStart;
+    for (int i = 0; i < capacity && copied; i++) {
+        Entry &entry = compacted[i];
+        if (entry.key[0] == '\0') continue;
+        copied = storage.read(containerPath, entry.offset, image + offset, entry.length) == entry.length;
+        entry.offset = offset;
+        entry.entryCrc = linarCrc32((const uint8_t *)&entry, offsetof(Entry, entryCrc));
+        offset += entry.length;
+    }
+    memcpy(image + sizeof(header), compacted, sizeof(compacted));
+
+    copied = copied && storage.write(containerPath, image, live);
+    free(image);
+    if (copied) {
+        memcpy(entries, compacted, sizeof(entries));
+        end = live;
+    }
+    return copied;
+}
+
+int LinarTableStore::count() {
+    Lock lock(mutex);
+    int tables = 0;
+    for (int i = 0; i < capacity; i++) {
+        if (entries[i].key[0] != '\0') tables++;
+    }
+    return tables;
+}
+
+size_t LinarTableStore::containerSize() {
+    Lock lock(mutex);
+    return end;
+}
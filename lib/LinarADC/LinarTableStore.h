@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "LinarStorage.h"
+
+/**
+ * @class LinarTableStore
+ * @brief Many named tables in one container blob, with an index for direct lookup.
+ *
+ * Without it, every channel, attenuation and temperature table is a separate
+ * file with its own open and parse cost. The container starts with a small
+ * index (key -> offset, length, CRC) that `begin()` reads once; after that a
+ * table is loaded with one read at its offset.
+ *
+ * Tables are never overwritten in place. An update appends the new data,
+ * then writes an index entry with a higher sequence number into a free
+ * slot, then frees the old entry. Index entries carry their own CRC, so a
+ * torn index write is ignored. Power loss at any point leaves either the old
+ * or the new table valid, provided the backend's `writeAt()` and `append()`
+ * keep the bytes they do not touch on a reset. All backends in
+ * LinarStorage.h do; on a raw partition this costs a copy of the container
+ * per index write. Appended space is not reclaimed; call `compact()`
+ * when the container has grown too much.
+ *
+ * All operations take a mutex, so tasks can look tables up concurrently.
+ *
+ * The store is itself a `LinarStorage`, so a `LinarADC` can keep all of its
+ * files in one container:
+ * @code
+ * LinarTableStore tables(LinarFsStorage::spiffs(), "/Calibration.tables");
+ * LinarADC ch0(34, ".bin", -1, -1, "Ch0");
+ * LinarADC ch1(35, ".bin", -1, -1, "Ch1");
+ * ch0.useStorage(tables);
+ * ch1.useStorage(tables);
+ * @endcode
+ */
+class LinarTableStore : public LinarStorage {
+public:
+    static constexpr int capacity = 16;     ///< Index slots; one stays free for updates, so 15 tables.
+    static constexpr int maxKeyLength = 31; ///< Longest key, without the terminator.
+
+    /**
+     * @brief Constructor to initialize the store.
+     *
+     * @param backend Storage holding the container.
+     * @param path    Key of the container in `backend`.
+     */
+    LinarTableStore(LinarStorage &backend, const char *path = "/LinarTables.bin");
+    ~LinarTableStore();
+
+    /**
+     * @brief Reads the index, creating an empty container if there is none.
+     */
+    bool begin() override;
+
+    size_t size(const char *key) override;
+
+    /**
+     * @brief Reads part of a table with one read of the container.
+     *
+     * A read covering the whole table is checked against its CRC and
+     * returns 0 on mismatch.
+     */
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override;
+    bool write(const char *key, const uint8_t *data, size_t length) override;
+
+    /**
+     * @brief Patches a table by writing a new version of it, never in place.
+     */
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override;
+    bool append(const char *key, const uint8_t *data, size_t length) override;
+    bool remove(const char *key) override;
+    bool checksum(const char *key, uint32_t &crc) override;
+    void release(const char *key) override;
+
+    /**
+     * @brief Rewrites the container with only the live tables.
+     *
+     * This is the one operation that rewrites everything. It needs RAM for
+     * the whole container and is not power-fail safe.
+     */
+    bool compact();
+
+    int count();                ///< Tables in the store.
+    size_t containerSize();     ///< Bytes used by the container, including stale tables.
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t slots;
+    };
+    struct Entry {
+        char key[maxKeyLength + 1];  ///< Empty for a free slot.
+        uint32_t offset;             ///< Start of the table in the container.
+        uint32_t length;
+        uint32_t crc;                ///< CRC-32 of the table.
+        uint32_t sequence;           ///< The newer entry wins if a crash left two for one key.
+        uint32_t entryCrc;           ///< CRC-32 of the fields above.
+    };
+    static constexpr uint32_t storeMagic = 0x5342544C; ///< "LTBS"
+    static constexpr size_t dataStart = sizeof(Header) + sizeof(Entry) * capacity;
+
+    int find(const char *key);
+    int freeSlot();
+    int freeSlots();
+    bool writeEntry(int slot, const Entry &entry);
+    bool storeLocked(const char *key, const uint8_t *data, size_t length);
+
+    LinarStorage &storage;
+    const char *containerPath;
+    SemaphoreHandle_t mutex;
+    bool loaded = false;
+    size_t end = 0;             ///< Container size, where the next table goes.
+    uint32_t nextSequence = 1;
+    Entry entries[capacity];
+    uint32_t hashes[capacity];  ///< Key hashes, compared before the key itself.
+};
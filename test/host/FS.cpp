@@ -0,0 +1,78 @@
+#include "FS.h"
+#include "SPIFFS.h"
+#include "LittleFS.h"
+
+fs::SPIFFSFS SPIFFS;
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+    if (!data || !writable) return 0;
+    if (data->size() < cursor + size) data->resize(cursor + size);
+    memcpy(data->data() + cursor, buffer, size);
+    cursor += size;
+    return size;
+}
+
+int File::read() {
+    uint8_t byte;
+    return read(&byte, 1) == 1 ? byte : -1;
+}
+
+int File::peek() {
+    return data && cursor < data->size() ? (*data)[cursor] : -1;
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+    if (!data || cursor >= data->size()) return 0;
+    size_t bytes = min(size, data->size() - cursor);
+    memcpy(buffer, data->data() + cursor, bytes);
+    cursor += bytes;
+    return bytes;
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    if (!data) return false;
+    size_t base = mode == SeekSet ? 0 : mode == SeekCur ? cursor : data->size();
+    if (base + position > data->size()) return false;
+    cursor = base + position;
+    return true;
+}
+
+File FS::open(const char *path, const char *mode, const bool create) {
+    if (!mounted || strlen(path) > maxPathLength) return File();
+    auto found = files.find(path);
+    bool exists = found != files.end();
+
+    if (strcmp(mode, "r") == 0) {
+        return exists ? File(found->second, false, 0) : File();
+    }
+    if (strcmp(mode, "r+") == 0) {
+        return exists ? File(found->second, true, 0) : File();
+    }
+    if (strcmp(mode, "w") == 0 || !exists) {
+        std::shared_ptr<FileData> created = std::make_shared<FileData>();
+        files[path] = created;
+        return File(created, true, 0);
+    }
+    return File(found->second, true, found->second->size());   // "a"
+}
+
+bool FS::rename(const char *from, const char *to) {
+    auto found = files.find(from);
+    if (!mounted || found == files.end() || strlen(to) > maxPathLength) return false;
+    std::shared_ptr<FileData> data = found->second;
+    files.erase(found);
+    files[to] = data;
+    return true;
+}
+
+bool FS::begin(bool formatOnFail) {
+    if (failMount) return false;
+    mounted = true;
+    mounts++;
+    return true;
+}
+
+}  // namespace fs
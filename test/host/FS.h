@@ -0,0 +1,79 @@
+#pragma once
+
+// In-memory filesystem with the Arduino fs::FS / fs::File interface.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+typedef std::vector<uint8_t> FileData;
+
+class File : public Stream {
+public:
+    File() = default;
+    File(std::shared_ptr<FileData> fileData, bool canWrite, size_t start)
+        :data(fileData), writable(canWrite), cursor(start) {}
+
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int available() override { return data ? (int)(data->size() - min(cursor, data->size())) : 0; }
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t *buffer, size_t size);
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const { return cursor; }
+    size_t size() const { return data ? data->size() : 0; }
+    void close() { data.reset(); }
+    bool isDirectory() const { return false; }
+    operator bool() const { return data != nullptr; }
+
+private:
+    std::shared_ptr<FileData> data;
+    bool writable = false;
+    size_t cursor = 0;
+};
+
+class FS {
+public:
+    File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+    File open(const String &path, const char *mode = FILE_READ, const bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char *path) { return mounted && files.count(path) > 0; }
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path) { return mounted && files.erase(path) > 0; }
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+
+    bool begin(bool formatOnFail = false);
+    void end() { mounted = false; }
+    bool format() { files.clear(); return true; }
+
+    int mounts = 0;             ///< Successful begin() calls.
+    bool failMount = false;     ///< Makes begin() fail.
+    size_t maxPathLength = 255; ///< Longer paths cannot be opened or renamed to.
+
+private:
+    std::map<std::string, std::shared_ptr<FileData>> files;
+    bool mounted = false;
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
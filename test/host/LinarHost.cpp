@@ -0,0 +1,525 @@
+#include "LinarHost.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include <nvs.h>
+#include <nvs_flash.h>
+#include <esp_timer.h>
+#include <esp_adc_cal.h>
+#include <esp_heap_caps.h>
+#include <driver/dac.h>
+#include <freertos/semphr.h>
+#include "SPIFFS.h"
+#include "LittleFS.h"
+#ifdef __GLIBC__
+#include <malloc.h>
+
+// glibc lets a program replace malloc and keeps the originals under these names
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *pointer);
+}
+#endif
+
+HardwareSerial Serial;
+
+namespace {
+
+std::map<int, int> pins;
+uint8_t dacLevels[DAC_CHANNEL_MAX] = {};
+int adcBits = 12;
+LinarHostAdcModel adcModel = linarHostDefaultAdc;
+
+// Clock
+std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+uint64_t skippedMicros = 0;
+
+uint64_t nowMicros() {
+    skippedMicros++;        // a busy wait on micros() always makes progress
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockStart)
+               .count() + skippedMicros;
+}
+
+// NVS: namespace -> key -> blob
+std::vector<std::string> nvsNamespaces;
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvsData;
+uint32_t nvsBlobReads = 0;
+
+// Partitions, with NOR flash semantics: an erase sets bytes to 0xFF, a write only clears bits
+struct Partition {
+    esp_partition_t info;
+    std::vector<uint8_t> flash;
+};
+std::vector<Partition *> partitions;
+long flashBudget = -1;
+uint32_t flashOperations = 0;
+std::set<spi_flash_mmap_handle_t> flashMappings;
+spi_flash_mmap_handle_t lastMapping = 0;
+constexpr uint32_t flashSector = 4096;
+
+bool flashOperation() {
+    if (flashBudget == 0) return false;
+    if (flashBudget > 0) flashBudget--;
+    flashOperations++;
+    return true;
+}
+
+Partition *partitionOf(const esp_partition_t *info) {
+    for (Partition *partition : partitions) {
+        if (&partition->info == info) return partition;
+    }
+    return nullptr;
+}
+
+// Timers fire only from linarHostFireTimers(), so tests decide when
+struct Timer {
+    esp_timer_create_args_t args;
+    bool running;
+};
+std::vector<Timer *> timers;
+
+// Heap: bytes held by live blocks, and the most ever held, overall and since the monitor started
+constexpr size_t heapSize = 4 * 1024 * 1024;
+std::atomic<size_t> heapUsed{0};
+std::atomic<size_t> heapPeak{0};
+std::atomic<size_t> heapLocalPeak{0};
+std::atomic<bool> heapMonitoring{false};
+
+void raiseTo(std::atomic<size_t> &peak, size_t used) {
+    size_t seen = peak.load();
+    while (used > seen && !peak.compare_exchange_weak(seen, used)) {}
+}
+
+#ifdef __GLIBC__
+void *heapTake(void *pointer) {
+    if (pointer == nullptr) return nullptr;
+    size_t used = heapUsed += malloc_usable_size(pointer);
+    raiseTo(heapPeak, used);
+    if (heapMonitoring) raiseTo(heapLocalPeak, used);
+    return pointer;
+}
+
+void heapGive(void *pointer) {
+    if (pointer != nullptr) heapUsed -= malloc_usable_size(pointer);
+}
+#endif
+
+}  // namespace
+
+
+struct LinarHostSemaphore {
+    std::mutex mutex;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+
+/* -------------------------------- Controls ------------------------------- */
+
+void linarHostReset() {
+    pins.clear();
+    memset(dacLevels, 0, sizeof(dacLevels));
+    adcBits = 12;
+    adcModel = linarHostDefaultAdc;
+    nvsNamespaces.clear();
+    nvsData.clear();
+    nvsBlobReads = 0;
+    for (Partition *partition : partitions) delete partition;
+    partitions.clear();
+    flashBudget = -1;
+    flashOperations = 0;
+    flashMappings.clear();
+    for (Timer *timer : timers) timer->running = false;
+    SPIFFS.format();
+    LittleFS.format();
+}
+
+void linarHostAdvanceMicros(uint32_t us) {
+    skippedMicros += us;
+}
+
+int linarHostPinLevel(int pin) {
+    auto found = pins.find(pin);
+    return found != pins.end() ? found->second : -1;
+}
+
+uint8_t linarHostDacLevel(int channel) {
+    return dacLevels[channel];
+}
+
+void linarHostSetAdcModel(LinarHostAdcModel model) {
+    adcModel = model != nullptr ? model : linarHostDefaultAdc;
+}
+
+int linarHostDefaultAdc(int pin, int bits) {
+    float x = dacLevels[DAC_CHANNEL_1] / 256.0f;
+    float bowed = x - 0.06f * x * (1 - x);
+    return constrain((int)lroundf(bowed * (1 << bits)), 0, (1 << bits) - 1);
+}
+
+const esp_partition_t *linarHostAddPartition(const char *label, uint32_t size) {
+    Partition *partition = new Partition();
+    partition->info.type = ESP_PARTITION_TYPE_DATA;
+    partition->info.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    partition->info.size = size;
+    snprintf(partition->info.label, sizeof(partition->info.label), "%s", label);
+    partition->flash.assign(size, 0xFF);
+    partitions.push_back(partition);
+    return &partition->info;
+}
+
+void linarHostFailFlashAfter(long operations) {
+    flashBudget = operations;
+}
+
+uint32_t linarHostFlashOperations() {
+    return flashOperations;
+}
+
+int linarHostFlashMappings() {
+    return (int)flashMappings.size();
+}
+
+uint32_t linarHostNvsBlobReads() {
+    return nvsBlobReads;
+}
+
+void linarHostFireTimers() {
+    std::vector<Timer *> due;
+    for (Timer *timer : timers) {
+        if (timer->running) due.push_back(timer);
+    }
+    for (Timer *timer : due) {
+        if (timer->running) timer->args.callback(timer->args.arg);
+    }
+}
+
+int linarHostRunningTimers() {
+    int running = 0;
+    for (Timer *timer : timers) running += timer->running;
+    return running;
+}
+
+size_t linarHostHeapUsed() {
+    return heapUsed;
+}
+
+
+/* --------------------------------- Arduino ------------------------------- */
+
+void pinMode(int pin, int mode) {}
+
+void digitalWrite(int pin, int level) {
+    pins[pin] = level;
+}
+
+int digitalRead(int pin) {
+    return linarHostPinLevel(pin) == HIGH ? HIGH : LOW;
+}
+
+int analogRead(int pin) {
+    return adcModel(pin, adcBits);
+}
+
+void analogReadResolution(int bits) {
+    adcBits = bits;
+}
+
+unsigned long millis() {
+    return nowMicros() / 1000;
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)nowMicros();
+}
+
+void delay(unsigned long ms) {
+    skippedMicros += ms * 1000;
+}
+
+void delayMicroseconds(unsigned int us) {
+    skippedMicros += us;
+}
+
+void yield() {}
+
+
+/* ----------------------------------- IDF --------------------------------- */
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    for (size_t i = 0; i < nvsNamespaces.size(); i++) {
+        if (nvsNamespaces[i] == name) {
+            *handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    nvsNamespaces.push_back(name);
+    *handle = nvsNamespaces.size();
+    return ESP_OK;
+}
+
+static std::map<std::string, std::vector<uint8_t>> *nvsSpace(nvs_handle_t handle) {
+    if (handle == 0 || handle > nvsNamespaces.size()) return nullptr;
+    return &nvsData[nvsNamespaces[handle - 1]];
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *value, size_t *length) {
+    auto *space = nvsSpace(handle);
+    if (space == nullptr) return ESP_ERR_INVALID_ARG;
+    auto found = space->find(key);
+    if (found == space->end()) return ESP_ERR_NVS_NOT_FOUND;
+
+    if (value == nullptr) {
+        *length = found->second.size();
+        return ESP_OK;
+    }
+    if (*length < found->second.size()) return ESP_ERR_NVS_INVALID_LENGTH;
+    memcpy(value, found->second.data(), found->second.size());
+    *length = found->second.size();
+    nvsBlobReads++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    auto *space = nvsSpace(handle);
+    if (space == nullptr) return ESP_ERR_INVALID_ARG;
+    (*space)[key].assign((const uint8_t *)value, (const uint8_t *)value + length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+    auto *space = nvsSpace(handle);
+    if (space == nullptr) return ESP_ERR_INVALID_ARG;
+    return space->erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return nvsSpace(handle) != nullptr ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+void nvs_close(nvs_handle_t handle) {}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    for (Partition *partition : partitions) {
+        if (partition->info.type == type && (label == nullptr || strcmp(partition->info.label, label) == 0)) {
+            return &partition->info;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *info, size_t offset, void *destination, size_t size) {
+    Partition *partition = partitionOf(info);
+    if (partition == nullptr || offset + size > info->size) return ESP_ERR_INVALID_ARG;
+    memcpy(destination, partition->flash.data() + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *info, size_t offset, const void *source, size_t size) {
+    Partition *partition = partitionOf(info);
+    if (partition == nullptr || offset + size > info->size) return ESP_ERR_INVALID_ARG;
+    if (!flashOperation()) return ESP_FAIL;
+    for (size_t i = 0; i < size; i++) partition->flash[offset + i] &= ((const uint8_t *)source)[i];
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *info, size_t offset, size_t size) {
+    Partition *partition = partitionOf(info);
+    if (partition == nullptr || offset + size > info->size) return ESP_ERR_INVALID_ARG;
+    if (offset % flashSector != 0 || size % flashSector != 0) return ESP_ERR_INVALID_SIZE;
+    if (!flashOperation()) return ESP_FAIL;
+    memset(partition->flash.data() + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *info, size_t offset, size_t size,
+                             spi_flash_mmap_memory_t memory, const void **out, spi_flash_mmap_handle_t *handle) {
+    Partition *partition = partitionOf(info);
+    if (partition == nullptr || offset + size > info->size) return ESP_ERR_INVALID_ARG;
+    *out = partition->flash.data() + offset;
+    *handle = ++lastMapping;
+    flashMappings.insert(*handle);
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) {
+    flashMappings.erase(handle);
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+    Timer *timer = new Timer{*args, false};
+    timers.push_back(timer);
+    *handle = (esp_timer_handle_t)timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t handle, uint64_t period) {
+    Timer *timer = (Timer *)handle;
+    if (timer->running) return ESP_ERR_INVALID_STATE;
+    timer->running = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t handle) {
+    Timer *timer = (Timer *)handle;
+    if (!timer->running) return ESP_ERR_INVALID_STATE;
+    timer->running = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t handle) {
+    Timer *timer = (Timer *)handle;
+    if (timer->running) return ESP_ERR_INVALID_STATE;
+    timers.erase(std::find(timers.begin(), timers.end(), timer));
+    delete timer;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+    return nowMicros();
+}
+
+esp_err_t esp_adc_cal_check_efuse(esp_adc_cal_value_t source) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t unit, adc_atten_t atten, adc_bits_width_t width,
+                                             uint32_t defaultVref, esp_adc_cal_characteristics_t *chars) {
+    memset(chars, 0, sizeof(*chars));
+    chars->vref = defaultVref;
+    return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+esp_err_t dac_output_enable(dac_channel_t channel) {
+    return ESP_OK;
+}
+
+esp_err_t dac_output_disable(dac_channel_t channel) {
+    return ESP_OK;
+}
+
+esp_err_t dac_output_voltage(dac_channel_t channel, uint8_t level) {
+    dacLevels[channel] = level;
+    return ESP_OK;
+}
+
+
+/* -------------------------------- FreeRTOS ------------------------------- */
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount) {
+    SemaphoreHandle_t semaphore = new LinarHostSemaphore();
+    semaphore->count = initialCount;
+    semaphore->maxCount = maxCount;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return createSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return createSemaphore(maxCount, initialCount);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    auto available = [&] { return semaphore->count > 0; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->changed.wait(lock, available);
+    } else if (!semaphore->changed.wait_for(lock, std::chrono::milliseconds(ticks), available)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->maxCount) return pdFALSE;
+    semaphore->count++;
+    semaphore->changed.notify_one();
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+
+/* ---------------------------------- Heap --------------------------------- */
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return heapSize - min((size_t)heapUsed, heapSize);
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    size_t peak = heapMonitoring ? heapLocalPeak : heapPeak;
+    return heapSize - min(peak, heapSize);
+}
+
+esp_err_t heap_caps_monitor_local_minimum_free_size_start(void) {
+    heapLocalPeak = (size_t)heapUsed;
+    heapMonitoring = true;
+    return ESP_OK;
+}
+
+esp_err_t heap_caps_monitor_local_minimum_free_size_stop(void) {
+    heapMonitoring = false;
+    return ESP_OK;
+}
+
+#ifdef __GLIBC__
+extern "C" {
+
+void *malloc(size_t size) {
+    return heapTake(__libc_malloc(size));
+}
+
+void *calloc(size_t count, size_t size) {
+    return heapTake(__libc_calloc(count, size));
+}
+
+void *realloc(void *pointer, size_t size) {
+    heapGive(pointer);
+    void *resized = __libc_realloc(pointer, size);
+    if (resized == nullptr && pointer != nullptr && size > 0) {
+        heapTake(pointer);      // failed, the old block is still live
+        return nullptr;
+    }
+    return heapTake(resized);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    return heapTake(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    return heapTake(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **pointer, size_t alignment, size_t size) {
+    *pointer = heapTake(__libc_memalign(alignment, size));
+    return *pointer != nullptr || size == 0 ? 0 : ENOMEM;
+}
+
+void free(void *pointer) {
+    heapGive(pointer);
+    __libc_free(pointer);
+}
+
+}  // extern "C"
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+// Controls of the host stand-ins, for tests and the host benchmark.
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+/**
+ * @brief Puts every stand-in back to its power-on state: clock, pins, DACs,
+ * the ADC model, NVS, partitions, timers and the filesystems.
+ */
+void linarHostReset();
+
+/**
+ * @brief Moves the clock on without sleeping.
+ */
+void linarHostAdvanceMicros(uint32_t us);
+
+/**
+ * @brief Level last written to `pin`, -1 if never written.
+ */
+int linarHostPinLevel(int pin);
+
+/**
+ * @brief Level last written to DAC channel `channel` (0 or 1).
+ */
+uint8_t linarHostDacLevel(int channel);
+
+/**
+ * @brief What `analogRead(pin)` returns at `bits` resolution.
+ *
+ * The default is a bowed, noiseless response to DAC channel 1, like an
+ * uncalibrated ESP32 ADC wired to the DAC.
+ */
+typedef int (*LinarHostAdcModel)(int pin, int bits);
+void linarHostSetAdcModel(LinarHostAdcModel model);
+int linarHostDefaultAdc(int pin, int bits);
+
+/**
+ * @brief Adds a data partition of `size` bytes, erased, for `esp_partition_find_first()`.
+ */
+const esp_partition_t *linarHostAddPartition(const char *label, uint32_t size);
+
+/**
+ * @brief Lets `operations` more flash erases and writes succeed, then fails all
+ * of them, as if the power went. -1 removes the limit.
+ */
+void linarHostFailFlashAfter(long operations);
+
+/**
+ * @brief Flash erases and writes done since the last reset.
+ */
+uint32_t linarHostFlashOperations();
+
+/**
+ * @brief Flash mappings made with `esp_partition_mmap()` and not yet unmapped.
+ */
+int linarHostFlashMappings();
+
+/**
+ * @brief `nvs_get_blob()` calls that copied a blob since the last reset.
+ */
+uint32_t linarHostNvsBlobReads();
+
+/**
+ * @brief Runs the callback of every started esp_timer once.
+ */
+void linarHostFireTimers();
+
+/**
+ * @brief esp_timers started and not stopped.
+ */
+int linarHostRunningTimers();
+
+/**
+ * @brief Heap bytes held by live allocations, counted on glibc only.
+ */
+size_t linarHostHeapUsed();
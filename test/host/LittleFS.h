@@ -0,0 +1,17 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+    bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = "spiffs") {
+        return FS::begin(formatOnFail);
+    }
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+class SPIFFSFS : public FS {
+public:
+    SPIFFSFS() { maxPathLength = 31; }    // SPIFFS_OBJ_NAME_LEN is 32, with the terminator
+
+    bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = nullptr) {
+        return FS::begin(formatOnFail);
+    }
+};
+
+}  // namespace fs
+
+extern fs::SPIFFSFS SPIFFS;
@@ -0,0 +1,57 @@
+#pragma once
+
+// A RAM storage that loses power part way through a write, for crash tests.
+
+#include <LinarStorage.h>
+
+/**
+ * Blobs in a `LinarRamStorage`, counting every byte written. After
+ * `powerLossAfter(bytes)` only that many more bytes are stored: the write
+ * that crosses the limit is cut there and fails, and every later write
+ * fails, until `powerBack()`. Stepping `bytes` over the length of an update
+ * interrupts it at every byte.
+ */
+class TornStorage : public LinarStorage {
+public:
+    void powerLossAfter(long bytes) { budget = bytes; }
+    void powerBack() { budget = -1; }
+    unsigned long bytesWritten() const { return written; }
+
+    bool begin() override { return true; }
+    size_t size(const char *key) override { return blobs.size(key); }
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override {
+        return blobs.read(key, offset, buffer, length);
+    }
+    bool write(const char *key, const uint8_t *data, size_t length) override {
+        if (budget == 0) return false;
+        size_t allowed = allow(length);
+        return blobs.write(key, data, allowed) && allowed == length;
+    }
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override {
+        if (budget == 0) return false;
+        size_t allowed = allow(length);
+        return (allowed == 0 || blobs.writeAt(key, offset, data, allowed)) && allowed == length;
+    }
+    bool append(const char *key, const uint8_t *data, size_t length) override {
+        if (budget == 0) return false;
+        size_t allowed = allow(length);
+        return (allowed == 0 || blobs.append(key, data, allowed)) && allowed == length;
+    }
+    bool remove(const char *key) override { return budget != 0 && blobs.remove(key); }
+    const uint8_t *map(const char *key, size_t &length) override { return blobs.map(key, length); }
+
+    LinarRamStorage blobs;
+
+private:
+    size_t allow(size_t length) {
+        if (budget >= 0) {
+            length = min(length, (size_t)budget);
+            budget -= length;
+        }
+        written += length;
+        return length;
+    }
+
+    long budget = -1;
+    unsigned long written = 0;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+// The host heap: every malloc, and so every new, is counted against a 4 MB
+// heap. Like ESP-IDF 5.2, a local minimum can be watched between start and stop.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+esp_err_t heap_caps_monitor_local_minimum_free_size_start(void);
+esp_err_t heap_caps_monitor_local_minimum_free_size_stop(void);
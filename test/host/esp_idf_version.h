@@ -0,0 +1,5 @@
+#pragma once
+
+// The host stands in for the ESP-IDF 4.4 of the Arduino-ESP32 2.x core
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(4, 4, 0)
@@ -0,0 +1,87 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <string>
+
+static LinarRamStorage *storage;
+static std::string logText;
+
+// Pin 35 reads a flat line, so its calibration cannot pass
+static int deadOn35(int pin, int bits) {
+    return pin == 35 ? 1 << (bits - 1) : linarHostDefaultAdc(pin, bits);
+}
+
+static void capture(const char *text) {
+    logText += text;
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+    logText.clear();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+void test_batch_saves_every_channel() {
+    LinarADC ch0(34, ".bin", -1, -1, "Ch0");
+    LinarADC ch1(35, ".bin", -1, -1, "Ch1");
+    ch0.useStorage(*storage);
+    ch1.useStorage(*storage);
+    ch0.debugfcn = capture;
+
+    LinarADC *channels[] = {&ch0, &ch1};
+    dac_channel_t dacs[] = {DAC_CHANNEL_1, DAC_CHANNEL_1};
+    uint32_t cycleTimeMs = 0;
+    TEST_ASSERT_TRUE(LinarADC::saveBatch(channels, dacs, 2, &cycleTimeMs));
+    TEST_ASSERT_GREATER_THAN(0, (int)cycleTimeMs);
+    TEST_ASSERT_TRUE(storage->size("/Ch0.bin") > 0);
+    TEST_ASSERT_TRUE(storage->size("/Ch1.bin") > 0);
+    TEST_ASSERT_TRUE(ch0.getReport().passed);
+    TEST_ASSERT_TRUE(ch1.getReport().passed);
+    TEST_ASSERT_TRUE(logText.find("Calibrated 2/2 channels in ") != std::string::npos);
+}
+
+void test_batch_reports_a_failing_channel() {
+    linarHostSetAdcModel(deadOn35);
+    LinarADC ch0(34, ".bin", -1, -1, "Ch0");
+    LinarADC ch1(35, ".bin", -1, -1, "Ch1");
+    ch0.useStorage(*storage);
+    ch1.useStorage(*storage);
+    ch0.debugfcn = capture;
+
+    LinarADC *channels[] = {&ch0, &ch1};
+    dac_channel_t dacs[] = {DAC_CHANNEL_1, DAC_CHANNEL_1};
+    TEST_ASSERT_FALSE(LinarADC::saveBatch(channels, dacs, 2));
+
+    // The good channel is still saved and in use; the bad one keeps no table
+    TEST_ASSERT_TRUE(ch0.getReport().passed);
+    TEST_ASSERT_FALSE(ch1.getReport().passed);
+    TEST_ASSERT_TRUE(storage->size("/Ch0.bin") > 0);
+    TEST_ASSERT_EQUAL_INT(0, (int)storage->size("/Ch1.bin"));
+    TEST_ASSERT_TRUE(logText.find("Calibrated 1/2 channels in ") != std::string::npos);
+}
+
+void test_batch_frees_buffers_when_storage_fails() {
+    LinarPartitionStorage missing("nolabel");
+    LinarADC ch0(34, ".bin", -1, -1, "Ch0");
+    LinarADC ch1(35, ".bin", -1, -1, "Ch1");
+    ch0.useStorage(*storage);
+    ch1.useStorage(missing);
+
+    LinarADC *channels[] = {&ch0, &ch1};
+    dac_channel_t dacs[] = {DAC_CHANNEL_1, DAC_CHANNEL_1};
+    size_t before = linarHostHeapUsed();
+    TEST_ASSERT_FALSE(LinarADC::saveBatch(channels, dacs, 2));
+    TEST_ASSERT_EQUAL_INT((int)before, (int)linarHostHeapUsed());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_saves_every_channel);
+    RUN_TEST(test_batch_reports_a_failing_channel);
+    RUN_TEST(test_batch_frees_buffers_when_storage_fails);
+    return UNITY_END();
+}
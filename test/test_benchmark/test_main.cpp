@@ -0,0 +1,113 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <ArduinoJson.h>
+#include <string>
+#include <vector>
+
+// Passes the benchmark output on to Serial and keeps its lines
+class Tee : public Print {
+public:
+    size_t write(uint8_t byte) override {
+        Serial.write(byte);
+        if (byte == '\n') {
+            lines.push_back(line);
+            line.clear();
+        } else {
+            line += (char)byte;
+        }
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+
+private:
+    std::string line;
+};
+
+static LinarRamStorage *storage;
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+// heapPeak of case `name`, -1 if it is missing
+static int heapPeakOf(const Tee &out, const char *name) {
+    for (const std::string &line : out.lines) {
+        JsonDocument doc;
+        deserializeJson(doc, line.c_str(), line.size());
+        if (strcmp(doc["bench"].as<const char *>(), name) == 0) return doc["heapPeak"].as<int>();
+    }
+    return -1;
+}
+
+// Every line is one JSON case with all fields, and `name` is among them
+static void assertCases(const Tee &out, const char *const *names, size_t count) {
+    std::vector<std::string> seen;
+    for (const std::string &line : out.lines) {
+        JsonDocument doc;
+        TEST_ASSERT_FALSE(deserializeJson(doc, line.c_str(), line.size()));
+        TEST_ASSERT_TRUE(doc["bench"].is<const char *>());
+        TEST_ASSERT_TRUE(doc["iterations"].as<int>() >= 1);
+        TEST_ASSERT_TRUE(doc["nsPerOp"].as<float>() >= 0);
+        TEST_ASSERT_TRUE(doc["cyclesPerOp"].as<float>() >= 0);
+        TEST_ASSERT_TRUE(doc["bytesPerOp"].as<int>() >= 0);
+        TEST_ASSERT_TRUE(doc["heapPeak"].is<int>());    // the host heap is counted
+        seen.push_back(doc["bench"].as<const char *>());
+    }
+    for (size_t i = 0; i < count; i++) {
+        bool found = false;
+        for (const std::string &name : seen) found = found || name == names[i];
+        TEST_ASSERT_TRUE_MESSAGE(found, names[i]);
+    }
+}
+
+void test_suite_passes_without_a_table() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_FALSE(adc.begin());
+    Tee out;
+    TEST_ASSERT_TRUE(adc.benchmark(out, 34));
+
+    const char *names[] = {"read_formula", "convert_batch_formula", "summarize_scalar", "build_lut", "build_lut_serial",
+                           "write_txt", "read_txt", "write_json", "read_json", "write_bin", "read_bin",
+                           "write_delta", "read_delta", "read_points", "lazy_first_hit", "lazy_hit"};
+    assertCases(out, names, sizeof(names) / sizeof(names[0]));
+    TEST_ASSERT_FALSE(adc.isCalibrated());
+
+    // Building from .points holds the interpolated curve while it inverts it
+    TEST_ASSERT_GREATER_OR_EQUAL((int)(sizeof(float) * 4096), heapPeakOf(out, "read_points"));
+    TEST_ASSERT_EQUAL_INT(0, heapPeakOf(out, "read_formula"));
+}
+
+void test_suite_passes_with_a_recorded_sweep() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    adc.recordSweeps = true;
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    static int before[4096];
+    for (int raw = 0; raw < 4096; raw++) before[raw] = adc.convert(raw);
+
+    Tee out;
+    TEST_ASSERT_TRUE(adc.benchmark(out, 34));
+    const char *names[] = {"read_calibrated", "convert_batch_calibrated", "read_fast", "convert_batch_fast",
+                           "export_c_array", "apply_lut_scalar"};
+    assertCases(out, names, sizeof(names) / sizeof(names[0]));
+
+    // The loaded table is left as it was
+    TEST_ASSERT_TRUE(adc.isCalibrated());
+    for (int raw = 0; raw < 4096; raw++) TEST_ASSERT_EQUAL_INT(before[raw], adc.convert(raw));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_suite_passes_without_a_table);
+    RUN_TEST(test_suite_passes_with_a_recorded_sweep);
+    return UNITY_END();
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <string>
+#include <vector>
+
+// Records what a Print receives and the size of every write
+class Capture : public Print {
+public:
+    size_t write(uint8_t byte) override { return write(&byte, 1); }
+    size_t write(const uint8_t *data, size_t size) override {
+        text.append((const char *)data, size);
+        writes.push_back(size);
+        return size;
+    }
+    using Print::write;
+
+    std::string text;
+    std::vector<size_t> writes;
+};
+
+static std::string sinkText;
+static int sinkCalls;
+
+static void countingSink(const char *txt) {
+    sinkText += txt;
+    sinkCalls++;
+}
+
+static int table[4097];
+
+void setUp() {
+    linarHostReset();
+    for (int i = 0; i <= 4096; i++) table[i] = i + (i * (4096 - i)) / 20000 - 3;
+    sinkText.clear();
+    sinkCalls = 0;
+}
+
+void tearDown() {}
+
+static void assertChunked(const Capture &out, size_t bytes) {
+    TEST_ASSERT_EQUAL_UINT32(bytes, out.text.size());
+    TEST_ASSERT_EQUAL_UINT32((bytes + LinarChunkWriter::chunkSize - 1) / LinarChunkWriter::chunkSize, out.writes.size());
+    for (size_t i = 0; i + 1 < out.writes.size(); i++) TEST_ASSERT_EQUAL_UINT32(LinarChunkWriter::chunkSize, out.writes[i]);
+}
+
+void test_c_array_is_valid_code() {
+    Capture out;
+    size_t bytes = linarExportTable(out, table, 4097, LinarExportFormat::CArray, "LUT");
+    assertChunked(out, bytes);
+
+    const std::string &text = out.text;
+    TEST_ASSERT_EQUAL_INT(0, (int)text.find("const int LUT[4097] = {\r\n"));
+    TEST_ASSERT_TRUE(text.find(",,") == std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("\r\n};\r\n", text.substr(text.size() - 6).c_str());
+
+    // Every value in order, 16 to a line
+    size_t at = text.find('{') + 1;
+    for (int i = 0; i <= 4096; i++) {
+        char *end;
+        long value = strtol(text.c_str() + at, &end, 10);
+        TEST_ASSERT_EQUAL_INT(table[i], value);
+        at = end - text.c_str();
+        if (i < 4096) TEST_ASSERT_EQUAL_INT(',', text[at++]);
+    }
+    int lines = 0;
+    for (char c : text) lines += c == '\n';
+    TEST_ASSERT_EQUAL_INT(1 + (4097 + 15) / 16 + 1, lines);
+}
+
+void test_csv_has_one_row_per_entry() {
+    Capture out;
+    size_t bytes = linarExportTable(out, table, 4097, LinarExportFormat::Csv);
+    assertChunked(out, bytes);
+
+    const char *row = out.text.c_str();
+    TEST_ASSERT_EQUAL_INT(0, strncmp(row, "code,value\r\n", 12));
+    row += 12;
+    for (int i = 0; i <= 4096; i++) {
+        int code, value, used;
+        int fields = sscanf(row, "%d,%d\r\n%n", &code, &value, &used);
+        TEST_ASSERT_EQUAL_INT(2, fields);
+        TEST_ASSERT_EQUAL_INT(i, code);
+        TEST_ASSERT_EQUAL_INT(table[i], value);
+        row += used;
+    }
+    TEST_ASSERT_EQUAL_INT('\0', *row);
+}
+
+void test_binary_matches_a_bin_file() {
+    static float results[4097];
+    for (int i = 0; i <= 4096; i++) results[i] = table[i] + (table[i] < 0 ? -0.75f : 0.75f);
+
+    Capture out;
+    size_t bytes = linarExportTable(out, results, 4097, LinarExportFormat::Binary);
+    assertChunked(out, bytes);
+    TEST_ASSERT_EQUAL_UINT32(4097 * sizeof(int32_t), bytes);
+    TEST_ASSERT_EQUAL_MEMORY(table, out.text.data(), bytes);    // floats are saved truncated towards 0
+}
+
+void test_sink_gets_whole_chunks() {
+    LinarSinkPrint sink(countingSink);
+    Capture reference;
+    size_t bytes = linarExportTable(sink, table, 4097, LinarExportFormat::CArray);
+    linarExportTable(reference, table, 4097, LinarExportFormat::CArray);
+    TEST_ASSERT_EQUAL_UINT32(reference.text.size(), bytes);
+    TEST_ASSERT_TRUE(sinkText == reference.text);
+    TEST_ASSERT_EQUAL_INT((int)reference.writes.size(), sinkCalls);
+}
+
+void test_adc_export_and_debug_dump() {
+    LinarRamStorage storage;
+    LinarADC adc;
+    adc.useStorage(storage);
+    Capture none;
+    TEST_ASSERT_EQUAL_UINT32(0, adc.exportTable(none));
+
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    Capture binary;
+    TEST_ASSERT_EQUAL_UINT32(4096 * sizeof(int32_t), adc.exportTable(binary, LinarExportFormat::Binary));
+    for (int raw = 0; raw < 4096; raw += 5) {
+        int32_t value;
+        memcpy(&value, binary.text.data() + raw * sizeof(value), sizeof(value));
+        TEST_ASSERT_EQUAL_INT(adc.convert(raw), value);
+    }
+
+    // The Debug dump of a save goes to debugfcn in chunks, not one call per entry
+    adc.debugfcn = countingSink;
+    adc.logLevel = LinarLogLevel::Debug;
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(sinkText.find("const int ADC_LUT[4096] = {") != std::string::npos);
+    TEST_ASSERT_TRUE(sinkText.find(",,") == std::string::npos);
+    TEST_ASSERT_LESS_THAN(400, sinkCalls);
+}
+
+void test_benchmark_times_every_format() {
+    LinarRamStorage storage;
+    LinarADC adc;
+    adc.useStorage(storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    Capture out;
+    TEST_ASSERT_TRUE(adc.benchmark(out, 34, 1000));
+    TEST_ASSERT_TRUE(out.text.find("{\"bench\":\"export_c_array\"") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find("{\"bench\":\"export_csv\"") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find("{\"bench\":\"export_binary\"") != std::string::npos);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_c_array_is_valid_code);
+    RUN_TEST(test_csv_has_one_row_per_entry);
+    RUN_TEST(test_binary_matches_a_bin_file);
+    RUN_TEST(test_sink_gets_whole_chunks);
+    RUN_TEST(test_adc_export_and_debug_dump);
+    RUN_TEST(test_benchmark_times_every_format);
+    return UNITY_END();
+}
@@ -0,0 +1,94 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarADCFast.h>
+#include <LinarHost.h>
+#include <string>
+
+static LinarRamStorage *storage;
+
+// Captures benchmark() output
+class Capture : public Print {
+public:
+    size_t write(uint8_t byte) override {
+        text += (char)byte;
+        return 1;
+    }
+    std::string text;
+};
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+template <uint8_t Bits>
+static void assertMatchesRuntimePath() {
+    static LinarADCFast<Bits> fast;
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.setResolution(Bits));
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    TEST_ASSERT_TRUE(fast.load(adc));
+    for (int raw = 0; raw < (1 << Bits); raw++) TEST_ASSERT_EQUAL_INT(adc.convert(raw), fast.convert(raw));
+
+    // read() masks the ADC result and needs no width check
+    for (int level = 0; level < 256; level += 17) {
+        dac_output_voltage(DAC_CHANNEL_1, level);
+        TEST_ASSERT_EQUAL_INT(adc.read(34), fast.read(34));
+    }
+}
+
+void test_matches_runtime_path_at_every_resolution() {
+    assertMatchesRuntimePath<9>();
+    assertMatchesRuntimePath<10>();
+    assertMatchesRuntimePath<11>();
+    assertMatchesRuntimePath<12>();
+}
+
+void test_formula_mode_needs_no_table() {
+    static LinarADCFast<12, uint16_t, false> raw;
+    static LinarADCFast<12> calibrated;
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_FALSE(adc.begin());
+    TEST_ASSERT_FALSE(calibrated.load(adc));
+    TEST_ASSERT_TRUE(raw.load(adc));
+    for (int code = 0; code < 4096; code += 13) {
+        TEST_ASSERT_EQUAL_INT(constrain(adc.formula(code), 0, 4095), raw.convert(code));
+    }
+}
+
+void test_load_refuses_another_resolution() {
+    static LinarADCFast<10> fast;
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    TEST_ASSERT_FALSE(fast.load(adc));
+}
+
+void test_benchmark_reports_the_fast_path() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    Capture out;
+    TEST_ASSERT_TRUE(adc.benchmark(out, 34, 1000));
+    TEST_ASSERT_TRUE(out.text.find("{\"bench\":\"read_fast\"") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find("{\"bench\":\"convert_batch_fast\"") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find("\"cyclesPerOp\":") != std::string::npos);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_runtime_path_at_every_resolution);
+    RUN_TEST(test_formula_mode_needs_no_table);
+    RUN_TEST(test_load_refuses_another_resolution);
+    RUN_TEST(test_benchmark_reports_the_fast_path);
+    return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <math.h>
+#include <vector>
+
+static LinarRamStorage *storage;
+
+// Dead below level 4 and saturated above level 252, so the curve has flat runs at both ends
+static int clippedAdc(int pin, int bits) {
+    int level = constrain(linarHostDacLevel(DAC_CHANNEL_1), 4, 252);
+    float x = (level - 4) / 248.0f;
+    return constrain((int)lroundf((x - 0.1f * x * (1 - x)) * (1 << bits)), 0, (1 << bits) - 1);
+}
+
+// Steeper in the middle than at the ends
+static int sCurveAdc(int pin, int bits) {
+    float x = linarHostDacLevel(DAC_CHANNEL_1) / 256.0f;
+    float s = x - 0.12f * sinf(2 * (float)M_PI * x) / (2 * (float)M_PI);
+    return constrain((int)lroundf(s * (1 << bits)), 0, (1 << bits) - 1);
+}
+
+/**
+ * The table the inversion must produce, by exhaustive search: for every
+ * output code, the first of the 5 * size curve samples nearest to it. The
+ * curve is rebuilt from the saved points with the same float operations as
+ * the library.
+ */
+static std::vector<int> exhaustiveTable(const float *points, int bits) {
+    int size = 1 << bits, stride = size / 256, samples = 5 * size;
+    std::vector<float> curve(size + 1);
+    for (int x = 0; x < size; x++) {
+        int i = x / stride, j = x % stride;
+        float start = points[i];
+        float end = i < 255 ? points[i + 1] : (float)(size - 1);
+        float value = j == 0 ? start : start + (end - start) * (float)j / stride;
+        curve[x] = 0.5 + value;
+    }
+    curve[size] = size - 0.5;
+
+    std::vector<int> table(size, 0);
+    for (int code = 1; code < size; code++) {
+        int index = 0;
+        float minDiff = 99999.0;
+        for (int j = 0; j < samples; j++) {
+            int i = j / 5;
+            float sample = curve[i] + (curve[i + 1] - curve[i]) * (float)(j % 5) / (float)10.0;
+            float diff = fabs((float)code - sample);
+            if (diff < minDiff) {
+                minDiff = diff;
+                index = j;
+            }
+        }
+        table[code] = (int)((float)index / 5);
+    }
+    return table;
+}
+
+static void assertMatchesExhaustiveSearch(LinarHostAdcModel model, int bits) {
+    linarHostReset();
+    linarHostSetAdcModel(model);
+    LinarADC adc(34, ".points");
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.setResolution(bits));
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+
+    float points[256];
+    TEST_ASSERT_EQUAL_UINT32(sizeof(points), storage->read("/CalibrationResults.points", 12, (uint8_t *)points, sizeof(points)));
+    std::vector<int> expected = exhaustiveTable(points, bits);
+    for (int raw = 0; raw < (1 << bits); raw++) TEST_ASSERT_EQUAL_INT(expected[raw], adc.convert(raw));
+}
+
+void setUp() {
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+void test_bowed_curve() {
+    assertMatchesExhaustiveSearch(linarHostDefaultAdc, 12);
+    assertMatchesExhaustiveSearch(linarHostDefaultAdc, 10);
+}
+
+void test_clipped_curve_with_flat_runs() {
+    assertMatchesExhaustiveSearch(clippedAdc, 12);
+    assertMatchesExhaustiveSearch(clippedAdc, 9);
+}
+
+void test_s_curve() {
+    assertMatchesExhaustiveSearch(sCurveAdc, 11);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_bowed_curve);
+    RUN_TEST(test_clipped_curve_with_flat_runs);
+    RUN_TEST(test_s_curve);
+    return UNITY_END();
+}
@@ -0,0 +1,103 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <LinarKernels.h>
+#include <vector>
+
+static const LinarKernels &scalar = linarKernels(LinarKernelPath::Scalar);
+static const LinarKernels &vector = linarKernels(LinarKernelPath::Vector);
+
+// Deterministic samples over the whole 16-bit range
+static std::vector<uint16_t> samples(size_t count, uint32_t seed) {
+    std::vector<uint16_t> block(count);
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        block[i] = seed >> 16;
+    }
+    return block;
+}
+
+void setUp() {
+    linarHostReset();
+}
+
+void tearDown() {}
+
+void test_both_paths_pass_the_self_check() {
+    TEST_ASSERT_TRUE(linarCheckKernels(LinarKernelPath::Scalar));
+    TEST_ASSERT_TRUE(linarCheckKernels(LinarKernelPath::Vector));
+    TEST_ASSERT_EQUAL_STRING("scalar", scalar.name);
+}
+
+void test_summarize_matches_a_plain_sum() {
+    for (size_t count = 0; count < 70; count++) {
+        std::vector<uint16_t> block = samples(count, count);
+        uint16_t low = count > 0 ? 65535 : 0, high = 0;
+        uint64_t sum = 0, sumSquares = 0;
+        for (uint16_t sample : block) {
+            low = min(low, sample);
+            high = max(high, sample);
+            sum += sample;
+            sumSquares += (uint64_t)sample * sample;
+        }
+
+        LinarSummary summary;
+        vector.summarize(block.data(), count, summary);
+        TEST_ASSERT_EQUAL_UINT32(count, summary.count);
+        TEST_ASSERT_EQUAL_UINT16(low, summary.min);
+        TEST_ASSERT_EQUAL_UINT16(high, summary.max);
+        TEST_ASSERT_TRUE(sum == summary.sum);
+        TEST_ASSERT_TRUE(sumSquares == summary.sumSquares);
+    }
+}
+
+void test_clamp_scale_saturates() {
+    std::vector<uint16_t> block = samples(100, 7), fast(100), plain(100);
+    block[0] = 0;
+    block[1] = 65535;
+    for (uint16_t gain : {0, 4096, 8192, 65535}) {
+        scalar.clampScale(block.data(), plain.data(), block.size(), 1000, 60000, gain);
+        vector.clampScale(block.data(), fast.data(), block.size(), 1000, 60000, gain);
+        TEST_ASSERT_EQUAL_UINT16_ARRAY(plain.data(), fast.data(), block.size());
+    }
+    TEST_ASSERT_EQUAL_UINT16(15999, plain[0]);     // 1000 * 65535 / 4096
+    TEST_ASSERT_EQUAL_UINT16(65535, plain[1]);     // 60000 times almost 16 saturates
+
+    scalar.clampScale(block.data(), plain.data(), 2, 1000, 60000, 4096);
+    TEST_ASSERT_EQUAL_UINT16(1000, plain[0]);
+    TEST_ASSERT_EQUAL_UINT16(60000, plain[1]);
+}
+
+static void assertBufferMatchesConvert(LinarKernelPath path, uint8_t bits) {
+    LinarRamStorage ram;
+    LinarADC adc;
+    adc.useStorage(ram);
+    adc.kernels = path;
+    TEST_ASSERT_TRUE(adc.setResolution(bits));
+    TEST_ASSERT_TRUE(adc.save());
+
+    // Raw readings above the resolution are masked, as convertBuffer() documents
+    std::vector<uint16_t> raw = samples(1000, bits), out(1000);
+    adc.convertBuffer(raw.data(), out.data(), raw.size());
+    for (size_t i = 0; i < raw.size(); i++) TEST_ASSERT_EQUAL_INT(adc.convert(raw[i] & ((1 << bits) - 1)), out[i]);
+
+    // In place
+    adc.convertBuffer(raw.data(), raw.data(), raw.size());
+    TEST_ASSERT_EQUAL_UINT16_ARRAY(out.data(), raw.data(), raw.size());
+}
+
+void test_convert_buffer_matches_convert() {
+    for (uint8_t bits = 9; bits <= 12; bits++) {
+        assertBufferMatchesConvert(LinarKernelPath::Scalar, bits);
+        assertBufferMatchesConvert(LinarKernelPath::Vector, bits);
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_both_paths_pass_the_self_check);
+    RUN_TEST(test_summarize_matches_a_plain_sum);
+    RUN_TEST(test_clamp_scale_saturates);
+    RUN_TEST(test_convert_buffer_matches_convert);
+    return UNITY_END();
+}
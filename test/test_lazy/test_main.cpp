@@ -0,0 +1,117 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarCodec.h>
+#include <LinarHost.h>
+
+static LinarRamStorage *storage;
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+static void calibrate(uint8_t bits) {
+    LinarADC adc(34, ".points");
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.setResolution(bits));
+    TEST_ASSERT_TRUE(adc.save());
+}
+
+// Writes a .points file the way writePoints() does, for curves a sweep would not produce
+static void writePoints(const float *points, uint8_t bits) {
+    uint8_t file[12 + sizeof(float) * 256];
+    uint32_t magic = 0x5354504C, crc = linarCrc32((const uint8_t *)points, sizeof(float) * 256);
+    uint16_t count = 256;
+    memcpy(file, &magic, 4);
+    memcpy(file + 4, &count, 2);
+    file[6] = bits;
+    file[7] = 0;
+    memcpy(file + 8, &crc, 4);
+    memcpy(file + 12, points, sizeof(float) * 256);
+    TEST_ASSERT_TRUE(storage->write("/CalibrationResults.points", file, sizeof(file)));
+}
+
+static void assertLazyMatchesFull(uint8_t bits) {
+    int size = 1 << bits;
+    calibrate(bits);
+
+    LinarADC full(34, ".points");
+    full.useStorage(*storage);
+    TEST_ASSERT_TRUE(full.setResolution(bits));
+    TEST_ASSERT_TRUE(full.begin());
+
+    LinarADC lazy(34, ".points");
+    lazy.useStorage(*storage);
+    lazy.lazyTable = true;
+    TEST_ASSERT_TRUE(lazy.setResolution(bits));
+    TEST_ASSERT_TRUE(lazy.begin());
+    TEST_ASSERT_EQUAL_INT(size / 64, lazy.getSegmentCount());
+    TEST_ASSERT_EQUAL_INT(0, lazy.getSegmentsBuilt());
+
+    for (int raw = 0; raw < size; raw++) TEST_ASSERT_EQUAL_INT(full.convert(raw), lazy.convert(raw));
+    TEST_ASSERT_EQUAL_INT(size / 64, lazy.getSegmentsBuilt());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(float) * 256 + size * sizeof(uint16_t), lazy.getTableBytes());
+}
+
+void test_lazy_matches_full_at_12_bits() {
+    assertLazyMatchesFull(12);
+}
+
+void test_lazy_matches_full_at_10_bits() {
+    assertLazyMatchesFull(10);
+}
+
+void test_narrow_band_builds_one_segment() {
+    calibrate(12);
+    LinarADC lazy(34, ".points");
+    lazy.useStorage(*storage);
+    lazy.lazyTable = true;
+    TEST_ASSERT_TRUE(lazy.begin());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(float) * 256, lazy.getTableBytes());
+
+    for (int raw = 2000; raw < 2040; raw++) lazy.convert(raw);
+    TEST_ASSERT_EQUAL_INT(1, lazy.getSegmentsBuilt());
+    TEST_ASSERT_EQUAL_UINT32(sizeof(float) * 256 + 64 * sizeof(uint16_t), lazy.getTableBytes());
+    TEST_ASSERT_EQUAL_INT(LinarLoadError::None, lazy.getLoadError());
+}
+
+/**
+ * One steep step up, a slow fall and a slow rise: the samples of the step
+ * leave gaps that only the fall fills, so the table jumps back and forth
+ * between the two. Its first and last entries still span the whole range.
+ */
+void test_lazy_rejects_what_full_rejects() {
+    float points[256];
+    points[0] = 0;
+    for (int i = 1; i < 128; i++) points[i] = 1000 - (i - 1) * 7.0f;
+    for (int i = 128; i < 256; i++) points[i] = 111 + (i - 128) * 7.0f;
+    writePoints(points, 10);
+
+    LinarADC full(34, ".points");
+    full.useStorage(*storage);
+    TEST_ASSERT_TRUE(full.setResolution(10));
+    TEST_ASSERT_FALSE(full.begin());
+    TEST_ASSERT_EQUAL_INT(LinarLoadError::Invalid, full.getLoadError());
+
+    LinarADC lazy(34, ".points");
+    lazy.useStorage(*storage);
+    lazy.lazyTable = true;
+    TEST_ASSERT_TRUE(lazy.setResolution(10));
+    TEST_ASSERT_FALSE(lazy.begin());
+    TEST_ASSERT_EQUAL_INT(LinarLoadError::Invalid, lazy.getLoadError());
+    TEST_ASSERT_EQUAL_INT(0, lazy.getSegmentCount());
+    TEST_ASSERT_EQUAL_UINT32(0, lazy.getTableBytes());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_lazy_matches_full_at_12_bits);
+    RUN_TEST(test_lazy_matches_full_at_10_bits);
+    RUN_TEST(test_narrow_band_builds_one_segment);
+    RUN_TEST(test_lazy_rejects_what_full_rejects);
+    return UNITY_END();
+}
@@ -0,0 +1,100 @@
+#include <unity.h>
+#include <LinarLed.h>
+#include <LinarHost.h>
+
+// Advances the clock one timer period at a time, as the esp_timer would
+static void runTimerFor(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += LinarLed::timerPeriodMs) {
+        linarHostAdvanceMicros(LinarLed::timerPeriodMs * 1000);
+        linarHostFireTimers();
+    }
+}
+
+void setUp() {
+    linarHostReset();
+}
+
+void tearDown() {}
+
+void test_timer_plays_and_stops_when_idle() {
+    LinarLed led;
+    TEST_ASSERT_EQUAL_INT(0, linarHostRunningTimers());
+    TEST_ASSERT_TRUE(led.blink(2, 100, 50));
+    TEST_ASSERT_EQUAL_INT(1, linarHostRunningTimers());
+
+    runTimerFor(10);
+    TEST_ASSERT_EQUAL_INT(LOW, linarHostPinLevel(2));
+    runTimerFor(100);
+    TEST_ASSERT_EQUAL_INT(HIGH, linarHostPinLevel(2));
+    TEST_ASSERT_TRUE(led.busy());
+
+    runTimerFor(60);
+    TEST_ASSERT_FALSE(led.busy());
+    TEST_ASSERT_EQUAL_INT(0, linarHostRunningTimers());
+}
+
+void test_blink_restarts_the_timer() {
+    LinarLed led;
+    TEST_ASSERT_TRUE(led.blink(2, 20, 20));
+    runTimerFor(100);
+    TEST_ASSERT_EQUAL_INT(0, linarHostRunningTimers());
+
+    TEST_ASSERT_TRUE(led.blink(4, 30, 30));
+    TEST_ASSERT_TRUE(led.blink(4, 30, 30));     // already running
+    TEST_ASSERT_EQUAL_INT(1, linarHostRunningTimers());
+    runTimerFor(10);
+    TEST_ASSERT_EQUAL_INT(LOW, linarHostPinLevel(4));
+    runTimerFor(200);
+    TEST_ASSERT_EQUAL_INT(HIGH, linarHostPinLevel(4));
+    TEST_ASSERT_FALSE(led.busy());
+    TEST_ASSERT_EQUAL_INT(0, linarHostRunningTimers());
+}
+
+void test_manual_mode_uses_no_timer() {
+    LinarLed led;
+    led.setManual(true);
+    TEST_ASSERT_TRUE(led.blink(2, 100, 100));
+    TEST_ASSERT_EQUAL_INT(0, linarHostRunningTimers());
+
+    led.tick(1000);
+    TEST_ASSERT_EQUAL_INT(LOW, linarHostPinLevel(2));
+    led.tick(1100);
+    TEST_ASSERT_EQUAL_INT(HIGH, linarHostPinLevel(2));
+    led.tick(1200);
+    TEST_ASSERT_FALSE(led.busy());
+
+    // Back to the timer with a pattern waiting
+    TEST_ASSERT_TRUE(led.blink(2, 100, 100));
+    led.setManual(false);
+    TEST_ASSERT_EQUAL_INT(1, linarHostRunningTimers());
+}
+
+void test_full_queue_drops_patterns() {
+    LinarLed led;
+    led.setManual(true);
+    for (int i = 0; i < LinarLed::queueSize; i++) TEST_ASSERT_TRUE(led.blink(2, 10, 10));
+    TEST_ASSERT_FALSE(led.blink(2, 10, 10));
+    TEST_ASSERT_FALSE(led.blink(-1, 10, 10));
+    TEST_ASSERT_EQUAL_UINT32(1, led.getDropped());
+}
+
+void test_destructor_releases_the_timer_and_led() {
+    {
+        LinarLed led;
+        TEST_ASSERT_TRUE(led.blink(2, 500, 500));
+        runTimerFor(10);
+        TEST_ASSERT_EQUAL_INT(LOW, linarHostPinLevel(2));
+    }
+    TEST_ASSERT_EQUAL_INT(0, linarHostRunningTimers());
+    TEST_ASSERT_EQUAL_INT(HIGH, linarHostPinLevel(2));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_plays_and_stops_when_idle);
+    RUN_TEST(test_blink_restarts_the_timer);
+    RUN_TEST(test_manual_mode_uses_no_timer);
+    RUN_TEST(test_full_queue_drops_patterns);
+    RUN_TEST(test_destructor_releases_the_timer_and_led);
+    return UNITY_END();
+}
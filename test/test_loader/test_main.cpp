@@ -0,0 +1,240 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarCodec.h>
+#include <LinarHost.h>
+#include <vector>
+
+static LinarRamStorage *ram;
+static int rawCode;
+
+/**
+ * A backend whose reads take 200 ms once `stalled` is set, like a hung flash or bus.
+ */
+class StalledStorage : public LinarStorage {
+public:
+    bool begin() override { return true; }
+    size_t size(const char *key) override { return blobs.size(key); }
+    size_t read(const char *key, size_t offset, uint8_t *buffer, size_t length) override {
+        if (stalled) linarHostAdvanceMicros(200000);
+        return blobs.read(key, offset, buffer, length);
+    }
+    bool write(const char *key, const uint8_t *data, size_t length) override { return blobs.write(key, data, length); }
+    bool writeAt(const char *key, size_t offset, const uint8_t *data, size_t length) override {
+        return blobs.writeAt(key, offset, data, length);
+    }
+    bool remove(const char *key) override { return blobs.remove(key); }
+
+    LinarRamStorage blobs;
+    bool stalled = false;
+};
+
+/**
+ * Stores every ".bin" table with entry 600 dropped to 0, as a bad flash page would.
+ */
+class CorruptingStorage : public StalledStorage {
+public:
+    bool write(const char *key, const uint8_t *data, size_t length) override {
+        if (!corrupt || !String(key).endsWith(".bin") || length < 601 * sizeof(int)) {
+            return StalledStorage::write(key, data, length);
+        }
+        std::vector<uint8_t> copy(data, data + length);
+        memset(&copy[600 * sizeof(int)], 0, sizeof(int));
+        return StalledStorage::write(key, copy.data(), copy.size());
+    }
+
+    bool corrupt = false;
+};
+
+// Bends the other way from the default model, so the two tables differ
+static int warmAdc(int pin, int bits) {
+    float x = linarHostDacLevel(DAC_CHANNEL_1) / 256.0f;
+    return constrain((int)lroundf((x + 0.08f * x * (1 - x)) * (1 << bits)), 0, (1 << bits) - 1);
+}
+
+static int fixedAdc(int pin, int bits) {
+    return rawCode;
+}
+
+static std::vector<uint8_t> contents(LinarStorage &store, const char *key) {
+    std::vector<uint8_t> data(store.size(key));
+    store.read(key, 0, data.data(), data.size());
+    return data;
+}
+
+static void readTable(LinarADC &adc, int *table) {
+    for (int raw = 0; raw < 4096; raw++) table[raw] = adc.convert(raw);
+}
+
+void setUp() {
+    linarHostReset();
+    ram = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete ram;
+}
+
+void test_delta_round_trip() {
+    static int table[4097], decoded[4097];
+    for (int i = 0; i <= 4096; i++) table[i] = i + (i * (4096 - i)) / 20000 + (i % 997 == 0 ? 300 : 0);
+
+    LinarBuffer buffer;
+    LinarDeltaEncoder encoder(buffer, 4097);
+    for (int i = 0; i <= 4096; i++) encoder.add(table[i]);
+    encoder.finish();
+    TEST_ASSERT_LESS_THAN(4096, (int)buffer.length());
+    TEST_ASSERT_TRUE(linarDeltaDecode(buffer.data(), buffer.length(), decoded, 4097));
+    TEST_ASSERT_EQUAL_INT_ARRAY(table, decoded, 4097);
+
+    // Every truncation is rejected, none reads past the end
+    for (size_t cut = 0; cut < buffer.length(); cut++) {
+        std::vector<uint8_t> truncated(buffer.data(), buffer.data() + cut);
+        TEST_ASSERT_FALSE(linarDeltaDecode(truncated.data(), truncated.size(), decoded, 4097));
+    }
+}
+
+void test_truncated_files_fail_with_an_error() {
+    const char *types[] = {".txt", ".json", ".bin", ".delta", ".points"};
+    for (const char *type : types) {
+        LinarADC adc(34, type);
+        adc.useStorage(*ram);
+        TEST_ASSERT_TRUE(adc.save());
+        String path = String("/CalibrationResults") + type;
+        std::vector<uint8_t> saved = contents(*ram, path.c_str());
+
+        size_t cuts[] = {1, 10, saved.size() / 3, saved.size() / 2};
+        for (size_t cut : cuts) {
+            ram->write(path.c_str(), saved.data(), cut);
+            LinarADC truncated(34, type);
+            truncated.useStorage(*ram);
+            TEST_ASSERT_FALSE_MESSAGE(truncated.begin(), type);
+            TEST_ASSERT_TRUE_MESSAGE(truncated.getLoadError() != LinarLoadError::None, type);
+        }
+    }
+}
+
+void test_stalled_storage_times_out() {
+    const char *types[] = {".txt", ".bin"};
+    for (const char *type : types) {
+        StalledStorage stalled;
+        LinarADC adc(34, type);
+        adc.useStorage(stalled);
+        TEST_ASSERT_TRUE(adc.save());
+        stalled.stalled = true;
+
+        LinarADC rebooted(34, type);
+        rebooted.useStorage(stalled);
+        TEST_ASSERT_FALSE(rebooted.begin());
+        TEST_ASSERT_EQUAL_INT((int)LinarLoadError::Timeout, (int)rebooted.getLoadError());
+    }
+}
+
+void test_rejected_file_leaves_the_table_in_use() {
+    static int previous[4096], current[4096];
+    CorruptingStorage storage;
+    LinarADC adc(34, ".bin");
+    adc.useStorage(storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    readTable(adc, previous);
+
+    // The new table differs from its first entry on, and fails the check in its third block
+    linarHostSetAdcModel(warmAdc);
+    storage.corrupt = true;
+    TEST_ASSERT_FALSE(adc.save());
+    TEST_ASSERT_EQUAL_INT((int)LinarLoadError::Invalid, (int)adc.getLoadError());
+    readTable(adc, current);
+    TEST_ASSERT_EQUAL_INT_ARRAY(previous, current, 4096);
+}
+
+void test_corrupt_slot_falls_back_for_every_format() {
+    static int previous[4096], loaded[4096];
+    const char *types[] = {".txt", ".json", ".delta", ".points"};
+    for (const char *type : types) {
+        linarHostReset();
+        LinarRamStorage backend;
+        LinarSlotStorage slots(backend);
+        LinarADC adc(34, type);
+        adc.useStorage(slots);
+        TEST_ASSERT_TRUE(adc.save());
+        TEST_ASSERT_TRUE(adc.begin());
+        readTable(adc, previous);
+        linarHostSetAdcModel(warmAdc);
+        TEST_ASSERT_TRUE(adc.save());
+
+        // One changed byte in the newer slot, well past the first read block
+        String slot = String("/CalibrationResults") + type + ".b";
+        std::vector<uint8_t> data = contents(backend, slot.c_str());
+        size_t at = data.size() * 3 / 4;
+        data[at] = data[at] >= '0' && data[at] < '9' ? data[at] + 1 : data[at] ^ 0x04;
+        backend.write(slot.c_str(), data.data(), data.size());
+
+        LinarSlotStorage reopened(backend);
+        LinarADC rebooted(34, type);
+        rebooted.useStorage(reopened);
+        TEST_ASSERT_TRUE_MESSAGE(rebooted.begin(), type);
+        TEST_ASSERT_EQUAL_INT_MESSAGE('a', reopened.activeSlot(slot.substring(0, slot.length() - 2).c_str()), type);
+        readTable(rebooted, loaded);
+        TEST_ASSERT_EQUAL_INT_ARRAY(previous, loaded, 4096);
+    }
+}
+
+void test_corrupt_temperature_slot_falls_back() {
+    static int cold[4096], loaded[4096];
+    LinarSlotStorage slots(*ram);
+    LinarADC adc;
+    adc.useStorage(slots);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(20));
+    linarHostSetAdcModel(fixedAdc);
+    TEST_ASSERT_TRUE(adc.begin());
+    adc.setTemperature(30);
+    for (rawCode = 0; rawCode < 4096; rawCode++) cold[rawCode] = adc.read(34);
+
+    linarHostSetAdcModel(warmAdc);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(30));
+    std::vector<uint8_t> data = contents(*ram, "/CalibrationResults.temp.b");
+    data[data.size() - 100] ^= 0x10;
+    ram->write("/CalibrationResults.temp.b", data.data(), data.size());
+
+    // Only the table captured at 20 C is left
+    LinarSlotStorage reopened(*ram);
+    LinarADC rebooted;
+    rebooted.useStorage(reopened);
+    linarHostSetAdcModel(fixedAdc);
+    TEST_ASSERT_TRUE(rebooted.begin());
+    rebooted.setTemperature(30);
+    for (rawCode = 0; rawCode < 4096; rawCode++) loaded[rawCode] = rebooted.read(34);
+    TEST_ASSERT_EQUAL_INT_ARRAY(cold, loaded, 4096);
+}
+
+void test_corrupt_sweep_slot_falls_back() {
+    LinarSlotStorage slots(*ram);
+    LinarADC adc;
+    adc.useStorage(slots);
+    adc.recordSweeps = true;
+    TEST_ASSERT_TRUE(adc.save());
+    linarHostSetAdcModel(warmAdc);
+    TEST_ASSERT_TRUE(adc.save());
+
+    std::vector<uint8_t> data = contents(*ram, "/CalibrationResults.sweep.b");
+    data[data.size() / 2] ^= 0x10;
+    ram->write("/CalibrationResults.sweep.b", data.data(), data.size());
+
+    LinarSlotStorage reopened(*ram);
+    LinarADC replayed;
+    replayed.useStorage(reopened);
+    TEST_ASSERT_TRUE(replayed.replaySweep());
+    TEST_ASSERT_EQUAL_INT('a', reopened.activeSlot("/CalibrationResults.sweep"));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_delta_round_trip);
+    RUN_TEST(test_truncated_files_fail_with_an_error);
+    RUN_TEST(test_stalled_storage_times_out);
+    RUN_TEST(test_rejected_file_leaves_the_table_in_use);
+    RUN_TEST(test_corrupt_slot_falls_back_for_every_format);
+    RUN_TEST(test_corrupt_temperature_slot_falls_back);
+    RUN_TEST(test_corrupt_sweep_slot_falls_back);
+    return UNITY_END();
+}
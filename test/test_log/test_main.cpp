@@ -0,0 +1,94 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <LinarLog.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Collects everything drained
+class Capture : public Print {
+public:
+    std::string text;
+    size_t write(uint8_t byte) override {
+        text += (char)byte;
+        return 1;
+    }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        text.append((const char *)buffer, size);
+        return size;
+    }
+};
+
+void setUp() {
+    linarHostReset();
+}
+
+void tearDown() {}
+
+void test_messages_wrap_around_the_buffer() {
+    LinarLogRing<16> ring;
+    Capture out;
+    TEST_ASSERT_TRUE(ring.push("abcdefghij"));
+    TEST_ASSERT_EQUAL_INT(10, (int)ring.drain(out));
+
+    // Starts at index 10 and ends at index 3
+    TEST_ASSERT_TRUE(ring.push("0123456789"));
+    TEST_ASSERT_EQUAL_INT(10, (int)ring.drain(out));
+    TEST_ASSERT_EQUAL_STRING("abcdefghij0123456789", out.text.c_str());
+    TEST_ASSERT_EQUAL_INT(0, (int)ring.drain(out));
+    TEST_ASSERT_EQUAL_UINT32(0, ring.getDropped());
+}
+
+void test_overflow_drops_whole_messages() {
+    LinarLogRing<16> ring;
+    Capture out;
+    TEST_ASSERT_TRUE(ring.push("0123456789"));
+    TEST_ASSERT_FALSE(ring.push("ABCDEFG"));        // 7 bytes, 6 free
+    TEST_ASSERT_TRUE(ring.push("abcdef"));          // fills it exactly
+    TEST_ASSERT_FALSE(ring.push("x"));
+    TEST_ASSERT_FALSE(ring.push("a message longer than the whole ring"));
+    TEST_ASSERT_EQUAL_UINT32(3, ring.getDropped());
+
+    TEST_ASSERT_EQUAL_INT(16, (int)ring.drain(out));
+    TEST_ASSERT_EQUAL_STRING("0123456789abcdef", out.text.c_str());
+    TEST_ASSERT_TRUE(ring.push("ABCDEFG"));         // room again once drained
+}
+
+void test_concurrent_push_and_drain() {
+    static LinarLogRing<256> ring;
+    const int messages = 20000;
+    std::atomic<bool> done{false};
+
+    // The producer retries a dropped message, so the output must hold every one in order
+    std::thread producer([&]() {
+        char line[16];
+        for (int i = 0; i < messages; i++) {
+            snprintf(line, sizeof(line), "m%05d\n", i);
+            while (!ring.push(line)) std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    Capture out;
+    while (!done) ring.drain(out);
+    ring.drain(out);
+    producer.join();
+
+    std::string expected;
+    char line[16];
+    for (int i = 0; i < messages; i++) {
+        snprintf(line, sizeof(line), "m%05d\n", i);
+        expected += line;
+    }
+    TEST_ASSERT_EQUAL_INT((int)expected.size(), (int)out.text.size());
+    TEST_ASSERT_TRUE(expected == out.text);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_messages_wrap_around_the_buffer);
+    RUN_TEST(test_overflow_drops_whole_messages);
+    RUN_TEST(test_concurrent_push_and_drain);
+    return UNITY_END();
+}
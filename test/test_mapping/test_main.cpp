@@ -0,0 +1,76 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+
+static LinarRamStorage *storage;
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+void test_ram_table_used_in_place() {
+    {
+        LinarADC adc;
+        adc.useStorage(*storage);
+        TEST_ASSERT_TRUE(adc.save());
+    }
+
+    LinarADC adc;
+    adc.useStorage(*storage);
+    size_t before = linarHostHeapUsed();
+    TEST_ASSERT_TRUE(adc.begin());
+    TEST_ASSERT_LESS_THAN(1024, (int)(linarHostHeapUsed() - before));
+    TEST_ASSERT_EQUAL_INT(0, (int)adc.getTableBytes());
+
+    // A change to the stored blob shows up in read(): the lookup indexes the blob itself
+    int value = 1234;
+    TEST_ASSERT_TRUE(storage->writeAt("/CalibrationResults.bin", sizeof(int) * 100, (const uint8_t *)&value, sizeof(value)));
+    TEST_ASSERT_EQUAL_INT(1234, adc.convert(100));
+}
+
+void test_partition_table_mapped_and_released() {
+    linarHostAddPartition("calib", 64 * 1024);
+    LinarPartitionStorage partition("calib");
+    int expected[4096];
+    {
+        LinarADC adc(34, ".bin");
+        adc.useStorage(partition);
+        TEST_ASSERT_TRUE(adc.save());
+        TEST_ASSERT_EQUAL_INT(0, linarHostFlashMappings());
+    }
+    TEST_ASSERT_EQUAL_INT((int)sizeof(expected),
+                          (int)partition.read("/CalibrationResults.bin", 0, (uint8_t *)expected, sizeof(expected)));
+
+    {
+        LinarADC adc(34, ".bin");
+        adc.useStorage(partition);
+        size_t before = linarHostHeapUsed();
+        TEST_ASSERT_TRUE(adc.begin());
+        TEST_ASSERT_LESS_THAN(1024, (int)(linarHostHeapUsed() - before));
+        TEST_ASSERT_EQUAL_INT(0, (int)adc.getTableBytes());
+        TEST_ASSERT_EQUAL_INT(1, linarHostFlashMappings());
+        for (int raw = 0; raw < 4096; raw++) TEST_ASSERT_EQUAL_INT(expected[raw], adc.convert(raw));
+
+        // A new resolution drops the mapped table
+        TEST_ASSERT_TRUE(adc.setResolution(10));
+        TEST_ASSERT_EQUAL_INT(0, linarHostFlashMappings());
+        TEST_ASSERT_TRUE(adc.setResolution(12));
+        TEST_ASSERT_TRUE(adc.begin());
+        TEST_ASSERT_EQUAL_INT(1, linarHostFlashMappings());
+    }
+
+    // The destructor unmaps
+    TEST_ASSERT_EQUAL_INT(0, linarHostFlashMappings());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_ram_table_used_in_place);
+    RUN_TEST(test_partition_table_mapped_and_released);
+    return UNITY_END();
+}
@@ -0,0 +1,96 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+
+// Millivolts of a calibrated reading come from the DAC scale; the eFuse
+// coefficients only apply to raw, uncalibrated readings.
+
+static LinarRamStorage *storage;
+
+static bool withCharacteristics(AdcCharacteristics &chars) {
+    chars.coeffA = 53000;
+    chars.coeffB = 142;
+    chars.vref = 1100;
+    return true;
+}
+
+// The ADC reads the DAC level linearly, so a calibrated reading is the DAC step
+static int linearAdc(int pin, int bits) {
+    return (linarHostDacLevel(DAC_CHANNEL_1) << (bits - 8)) + (1 << (bits - 8)) / 2;
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+static void calibrate(LinarADC &adc) {
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+}
+
+void test_calibrated_reading_uses_dac_scale() {
+    LinarADC adc;
+    adc.characteristicsfcn = withCharacteristics;
+    linarHostSetAdcModel(linearAdc);
+    calibrate(adc);
+
+    for (int level = 16; level < 256; level += 32) {
+        dac_output_voltage(DAC_CHANNEL_1, level);
+        TEST_ASSERT_INT_WITHIN(2 * 3300 / 256, level * 3300 / 256, adc.readMillivolts(34));
+    }
+}
+
+void test_eFuse_scale_ignored_when_calibrated() {
+    LinarADC withEfuse;
+    withEfuse.characteristicsfcn = withCharacteristics;
+    calibrate(withEfuse);
+
+    LinarADC withoutEfuse;
+    withoutEfuse.characteristicsfcn = nullptr;
+    withoutEfuse.useStorage(*storage);
+    TEST_ASSERT_TRUE(withoutEfuse.begin());
+
+    for (int level = 8; level < 256; level += 16) {
+        dac_output_voltage(DAC_CHANNEL_1, level);
+        TEST_ASSERT_EQUAL_INT(withoutEfuse.readMillivolts(34), withEfuse.readMillivolts(34));
+    }
+}
+
+void test_uncalibrated_reading_uses_eFuse_line() {
+    LinarADC adc;
+    adc.characteristicsfcn = withCharacteristics;
+    adc.useStorage(*storage);
+    TEST_ASSERT_FALSE(adc.begin());         // no table: raw readings
+
+    dac_output_voltage(DAC_CHANNEL_1, 128);
+    int raw = analogRead(34);
+    TEST_ASSERT_EQUAL_INT(((53000 * raw + 32768) >> 16) + 142, adc.readMillivolts(34));
+}
+
+void test_uncalibrated_reading_without_eFuse_uses_polynomial() {
+    LinarADC adc;
+    adc.characteristicsfcn = nullptr;
+    adc.useStorage(*storage);
+    TEST_ASSERT_FALSE(adc.begin());
+
+    dac_output_voltage(DAC_CHANNEL_1, 128);
+    int raw = analogRead(34);
+    double volts = -0.000000000000016 * pow(raw, 4) + 0.000000000118171 * pow(raw, 3) -
+                   0.000000301211691 * pow(raw, 2) + 0.001109019271794 * raw + 0.034143524634089;
+    TEST_ASSERT_INT_WITHIN(1, lround(volts * 1000), adc.readMillivolts(34));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_calibrated_reading_uses_dac_scale);
+    RUN_TEST(test_eFuse_scale_ignored_when_calibrated);
+    RUN_TEST(test_uncalibrated_reading_uses_eFuse_line);
+    RUN_TEST(test_uncalibrated_reading_without_eFuse_uses_polynomial);
+    return UNITY_END();
+}
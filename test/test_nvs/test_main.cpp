@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <vector>
+
+static std::vector<uint8_t> blob(int seed, size_t length) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; i++) data[i] = (uint8_t)(seed * 13 + i * 5);
+    return data;
+}
+
+static std::vector<uint8_t> readInBlocks(LinarStorage &store, const char *key, size_t block) {
+    std::vector<uint8_t> data(store.size(key));
+    for (size_t offset = 0; offset < data.size(); offset += block) {
+        size_t bytes = min(block, data.size() - offset);
+        TEST_ASSERT_EQUAL_UINT32(bytes, store.read(key, offset, data.data() + offset, bytes));
+    }
+    return data;
+}
+
+void setUp() {
+    linarHostReset();
+}
+
+void tearDown() {}
+
+void test_block_reads_fetch_the_blob_once() {
+    LinarNvsStorage nvs;
+    TEST_ASSERT_TRUE(nvs.begin());
+    std::vector<uint8_t> data = blob(1, 5000);
+    TEST_ASSERT_TRUE(nvs.write("/t.bin", data.data(), data.size()));
+
+    uint32_t before = linarHostNvsBlobReads();
+    TEST_ASSERT_TRUE(readInBlocks(nvs, "/t.bin", 1024) == data);
+    TEST_ASSERT_EQUAL_UINT32(1, linarHostNvsBlobReads() - before);
+
+    // The copy is gone after the last block, so the next pass fetches again
+    TEST_ASSERT_TRUE(readInBlocks(nvs, "/t.bin", 1024) == data);
+    TEST_ASSERT_EQUAL_UINT32(2, linarHostNvsBlobReads() - before);
+}
+
+void test_write_between_blocks_is_seen() {
+    LinarNvsStorage nvs;
+    TEST_ASSERT_TRUE(nvs.begin());
+    std::vector<uint8_t> first = blob(1, 3000);
+    std::vector<uint8_t> second = blob(2, 3000);
+    uint8_t block[1000];
+    TEST_ASSERT_TRUE(nvs.write("/t.bin", first.data(), first.size()));
+    TEST_ASSERT_EQUAL_UINT32(1000, nvs.read("/t.bin", 0, block, sizeof(block)));
+
+    TEST_ASSERT_TRUE(nvs.write("/t.bin", second.data(), second.size()));
+    TEST_ASSERT_EQUAL_UINT32(1000, nvs.read("/t.bin", 1000, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(second.data() + 1000, block, sizeof(block));
+}
+
+// Loads a saved table and returns the blobs fetched, checking it against the original
+static uint32_t fetchesPerLoad(const char *type, bool slots, int saves) {
+    LinarNvsStorage nvs;
+    LinarSlotStorage slotted(nvs);
+    LinarStorage &store = slots ? (LinarStorage &)slotted : nvs;
+    LinarADC adc(34, type);
+    adc.useStorage(store);
+    for (int i = 0; i < saves; i++) TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+
+    LinarSlotStorage reopened(nvs);
+    LinarADC rebooted(34, type);
+    rebooted.useStorage(slots ? (LinarStorage &)reopened : nvs);
+    uint32_t before = linarHostNvsBlobReads();
+    TEST_ASSERT_TRUE(rebooted.begin());
+    uint32_t fetches = linarHostNvsBlobReads() - before;
+    for (int raw = 0; raw < 4096; raw += 7) TEST_ASSERT_EQUAL_INT(adc.convert(raw), rebooted.convert(raw));
+    return fetches;
+}
+
+void test_bin_load_fetches_the_blob_once() {
+    TEST_ASSERT_EQUAL_UINT32(1, fetchesPerLoad(".bin", false, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, fetchesPerLoad(".bin", true, 1));
+}
+
+void test_text_load_fetches_the_blob_once() {
+    TEST_ASSERT_EQUAL_UINT32(1, fetchesPerLoad(".txt", false, 1));
+    TEST_ASSERT_EQUAL_UINT32(1, fetchesPerLoad(".txt", true, 1));
+}
+
+void test_each_slot_header_costs_one_fetch() {
+    // Slot b is newer and its header is read last, so its copy serves the payload
+    TEST_ASSERT_EQUAL_UINT32(2, fetchesPerLoad(".bin", true, 2));
+    TEST_ASSERT_EQUAL_UINT32(2, fetchesPerLoad(".txt", true, 2));
+
+    // Slot a is newer and is fetched again
+    TEST_ASSERT_EQUAL_UINT32(3, fetchesPerLoad(".bin", true, 3));
+    TEST_ASSERT_EQUAL_UINT32(3, fetchesPerLoad(".txt", true, 3));
+}
+
+void test_filesystem_block_reads_match() {
+    LinarFsStorage &fs = LinarFsStorage::spiffs();
+    TEST_ASSERT_TRUE(fs.begin());
+    std::vector<uint8_t> first = blob(3, 4000);
+    std::vector<uint8_t> second = blob(4, 4000);
+    TEST_ASSERT_TRUE(fs.write("/t.bin", first.data(), first.size()));
+    TEST_ASSERT_TRUE(readInBlocks(fs, "/t.bin", 1024) == first);
+
+    // A write closes the file kept open between blocks
+    uint8_t block[1000];
+    TEST_ASSERT_EQUAL_UINT32(1000, fs.read("/t.bin", 0, block, sizeof(block)));
+    TEST_ASSERT_TRUE(fs.write("/t.bin", second.data(), second.size()));
+    TEST_ASSERT_EQUAL_UINT32(1000, fs.read("/t.bin", 1000, block, sizeof(block)));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(second.data() + 1000, block, sizeof(block));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_block_reads_fetch_the_blob_once);
+    RUN_TEST(test_write_between_blocks_is_seen);
+    RUN_TEST(test_bin_load_fetches_the_blob_once);
+    RUN_TEST(test_text_load_fetches_the_blob_once);
+    RUN_TEST(test_each_slot_header_costs_one_fetch);
+    RUN_TEST(test_filesystem_block_reads_match);
+    return UNITY_END();
+}
@@ -0,0 +1,95 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <LinarParallel.h>
+#include <math.h>
+#include <vector>
+
+static LinarRamStorage *storage;
+
+// The default response with a little deterministic noise, so the curve is not ascending
+static int noisyAdc(int pin, int bits) {
+    int level = linarHostDacLevel(DAC_CHANNEL_1);
+    int noise = (level * 37 % 7) - 3;
+    return constrain(linarHostDefaultAdc(pin, bits) + noise, 0, (1 << bits) - 1);
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+static std::vector<int> tableBuiltWith(int tasks, uint8_t bits, const char *type) {
+    LinarADC adc(34, type);
+    adc.useStorage(*storage);
+    adc.buildTasks = tasks;
+    TEST_ASSERT_TRUE(adc.setResolution(bits));
+    TEST_ASSERT_TRUE(adc.begin());
+
+    std::vector<int> table(1 << bits);
+    for (int raw = 0; raw < (1 << bits); raw++) table[raw] = adc.convert(raw);
+    return table;
+}
+
+static void assertSplitMatchesSerial(LinarHostAdcModel model, uint8_t bits) {
+    linarHostSetAdcModel(model);
+    LinarADC adc(34, ".points");
+    adc.useStorage(*storage);
+    adc.buildTasks = 1;
+    TEST_ASSERT_TRUE(adc.setResolution(bits));
+    TEST_ASSERT_TRUE(adc.save());
+
+    // .points rebuilds the table at every begin(), through the same inversion as a sweep
+    std::vector<int> serial = tableBuiltWith(1, bits, ".points");
+    for (int tasks = 2; tasks <= 4; tasks++) {
+        std::vector<int> split = tableBuiltWith(tasks, bits, ".points");
+        TEST_ASSERT_EQUAL_INT_ARRAY(serial.data(), split.data(), serial.size());
+    }
+}
+
+void test_split_matches_serial_on_an_ascending_curve() {
+    assertSplitMatchesSerial(linarHostDefaultAdc, 12);
+    assertSplitMatchesSerial(linarHostDefaultAdc, 9);
+}
+
+void test_split_matches_serial_on_a_noisy_curve() {
+    assertSplitMatchesSerial(noisyAdc, 10);
+}
+
+void test_calibration_does_not_depend_on_the_split() {
+    std::vector<int> tables[2];
+    for (int tasks = 1; tasks <= 2; tasks++) {
+        linarHostReset();
+        LinarRamStorage ram;
+        LinarADC adc;
+        adc.useStorage(ram);
+        adc.buildTasks = tasks;
+        TEST_ASSERT_TRUE(adc.save());
+        for (int raw = 0; raw < 4096; raw++) tables[tasks - 1].push_back(adc.convert(raw));
+    }
+    TEST_ASSERT_EQUAL_INT_ARRAY(tables[0].data(), tables[1].data(), 4096);
+}
+
+static void markPart(void *context, int part) {
+    ((int *)context)[part]++;
+}
+
+void test_every_part_runs_once() {
+    int runs[8] = {};
+    linarParallel(8, markPart, runs);
+    for (int part = 0; part < 8; part++) TEST_ASSERT_EQUAL_INT(1, runs[part]);
+    TEST_ASSERT_TRUE(linarCoreCount() >= 1);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_split_matches_serial_on_an_ascending_curve);
+    RUN_TEST(test_split_matches_serial_on_a_noisy_curve);
+    RUN_TEST(test_calibration_does_not_depend_on_the_split);
+    RUN_TEST(test_every_part_runs_once);
+    return UNITY_END();
+}
@@ -0,0 +1,124 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+
+// Pin 34 is wired to DAC1; pins 35 and 36 hold two fixed references. The
+// drift moves every raw reading by the same gain and offset.
+
+static LinarRamStorage *storage;
+static float driftGain;
+static int driftOffset;
+static const int referenceLevel1 = 64;      // 825 mV
+static const int referenceLevel2 = 192;     // 2475 mV
+
+static int level(int pin) {
+    if (pin == 35) return referenceLevel1;
+    if (pin == 36) return referenceLevel2;
+    return linarHostDacLevel(DAC_CHANNEL_1);
+}
+
+static int driftingAdc(int pin, int bits) {
+    float x = level(pin) / 256.0f;
+    float bowed = (x - 0.06f * x * (1 - x)) * (1 << bits);
+    return constrain((int)lroundf(bowed * driftGain) + driftOffset, 0, (1 << bits) - 1);
+}
+
+static int millivolts(int dacLevel) {
+    return dacLevel * 3300 / 256;
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+    driftGain = 1;
+    driftOffset = 0;
+    linarHostSetAdcModel(driftingAdc);
+}
+
+void tearDown() {
+    delete storage;
+}
+
+static void calibrate(LinarADC &adc) {
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+}
+
+static int errorAt(LinarADC &adc, int dacLevel) {
+    dac_output_voltage(DAC_CHANNEL_1, dacLevel);
+    return adc.read(34) - dacLevel * 16;
+}
+
+void test_single_point_removes_offset_drift() {
+    LinarADC adc;
+    calibrate(adc);
+    driftOffset = 40;
+    TEST_ASSERT_GREATER_THAN(30, errorAt(adc, referenceLevel1));
+
+    TEST_ASSERT_TRUE(adc.recalibrate(35, millivolts(referenceLevel1)));
+    TEST_ASSERT_INT_WITHIN(2, 0, errorAt(adc, referenceLevel1));
+    for (int dacLevel = 16; dacLevel < 240; dacLevel += 16) {
+        TEST_ASSERT_INT_WITHIN(6, 0, errorAt(adc, dacLevel));
+    }
+}
+
+void test_two_points_remove_gain_and_offset_drift() {
+    LinarADC adc;
+    calibrate(adc);
+    driftGain = 1.04f;
+    driftOffset = -30;
+
+    TEST_ASSERT_TRUE(adc.recalibrate(35, millivolts(referenceLevel1), 36, millivolts(referenceLevel2)));
+    TEST_ASSERT_INT_WITHIN(2, 0, errorAt(adc, referenceLevel1));
+    TEST_ASSERT_INT_WITHIN(2, 0, errorAt(adc, referenceLevel2));
+    for (int dacLevel = 32; dacLevel < 224; dacLevel += 16) {
+        TEST_ASSERT_INT_WITHIN(6, 0, errorAt(adc, dacLevel));
+    }
+}
+
+void test_correction_is_patched_into_bin() {
+    LinarADC adc;
+    calibrate(adc);
+    driftOffset = 25;
+    TEST_ASSERT_TRUE(adc.recalibrate(35, millivolts(referenceLevel1)));
+
+    LinarADC reloaded;
+    reloaded.useStorage(*storage);
+    TEST_ASSERT_TRUE(reloaded.begin());
+    for (int dacLevel = 0; dacLevel < 256; dacLevel += 8) {
+        dac_output_voltage(DAC_CHANNEL_1, dacLevel);
+        TEST_ASSERT_EQUAL_INT(adc.read(34), reloaded.read(34));
+    }
+}
+
+void test_rejects_implausible_gain() {
+    LinarADC adc;
+    calibrate(adc);
+    driftGain = 1.3f;
+    TEST_ASSERT_FALSE(adc.recalibrate(35, millivolts(referenceLevel1), 36, millivolts(referenceLevel2)));
+}
+
+void test_rejects_references_too_close() {
+    LinarADC adc;
+    calibrate(adc);
+    TEST_ASSERT_FALSE(adc.recalibrate(35, millivolts(referenceLevel1), 35, millivolts(referenceLevel1)));
+}
+
+void test_needs_a_table() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_FALSE(adc.begin());
+    TEST_ASSERT_FALSE(adc.recalibrate(35, millivolts(referenceLevel1)));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_point_removes_offset_drift);
+    RUN_TEST(test_two_points_remove_gain_and_offset_drift);
+    RUN_TEST(test_correction_is_patched_into_bin);
+    RUN_TEST(test_rejects_implausible_gain);
+    RUN_TEST(test_rejects_references_too_close);
+    RUN_TEST(test_needs_a_table);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+
+static LinarRamStorage *storage;
+static uint32_t samples;
+
+// Holds one reading over a band of DAC levels, as a stuck comparator would
+static int stuckAdc(int pin, int bits) {
+    int dacLevel = linarHostDacLevel(DAC_CHANNEL_1);
+    if (dacLevel >= 120 && dacLevel < 128) dacLevel = 120;
+    return dacLevel << (bits - 8);
+}
+
+// Moves 100 codes once the 256 x 500 sweep samples are taken, before the check
+static int driftingAdc(int pin, int bits) {
+    int offset = ++samples > 256 * 500 ? 100 : 0;
+    return constrain(linarHostDefaultAdc(pin, bits) + offset, 0, (1 << bits) - 1);
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+    samples = 0;
+}
+
+void tearDown() {
+    delete storage;
+}
+
+void test_report_of_good_calibration() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+
+    const CalibrationReport &report = adc.getReport();
+    TEST_ASSERT_TRUE(report.passed);
+    TEST_ASSERT_GREATER_THAN(200, report.pointCount);
+    TEST_ASSERT_LESS_THAN(report.rmsRaw, report.rmsCalibrated);
+    TEST_ASSERT_LESS_OR_EQUAL(1.0f, report.rmsCalibrated);
+    TEST_ASSERT_INT_WITHIN(4, 0, report.maxInl);
+    TEST_ASSERT_INT_WITHIN(4, 0, report.maxDnl);
+
+    uint32_t counted = 0;
+    for (int i = 0; i < CalibrationReport::histogramBins; i++) counted += report.histogram[i];
+    TEST_ASSERT_EQUAL_UINT32(report.pointCount, counted);
+}
+
+void test_inl_and_dnl_agree() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+
+    // DNL is the step of the INL, except at the first point measured
+    const CalibrationReport &report = adc.getReport();
+    for (int i = 2; i <= report.pointCount; i++) {
+        TEST_ASSERT_EQUAL_INT(report.inl[i] - report.inl[i - 1], report.dnl[i]);
+    }
+}
+
+void test_stuck_band_gives_missing_codes() {
+    linarHostSetAdcModel(stuckAdc);
+    LinarADC adc;
+    adc.useStorage(*storage);
+    adc.save();
+    TEST_ASSERT_GREATER_THAN(0, adc.getReport().missingCodes);
+}
+
+void test_drifting_board_fails() {
+    linarHostSetAdcModel(driftingAdc);
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_FALSE(adc.save());
+    TEST_ASSERT_FALSE(adc.getReport().passed);
+    TEST_ASSERT_GREATER_THAN(1.0f, adc.getReport().rmsCalibrated);
+}
+
+void test_report_saved_as_json() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+
+    const char *path = "/CalibrationResults.rpt";
+    size_t length = storage->size(path);
+    TEST_ASSERT_GREATER_THAN(0, length);
+    char *text = new char[length];
+    TEST_ASSERT_EQUAL_size_t(length, storage->read(path, 0, (uint8_t *)text, length));
+    JsonDocument json;
+    DeserializationError error = deserializeJson(json, text, length);
+    delete[] text;
+    TEST_ASSERT_FALSE(error);
+
+    const CalibrationReport &report = adc.getReport();
+    TEST_ASSERT_TRUE(json["passed"].as<bool>());
+    TEST_ASSERT_EQUAL_INT(report.pointCount, json["points"].as<int>());
+    TEST_ASSERT_EQUAL_INT(report.maxInl, json["maxInl"].as<int>());
+    TEST_ASSERT_EQUAL_INT(report.missingCodes, json["missingCodes"].as<int>());
+    TEST_ASSERT_EQUAL_size_t(CalibrationReport::histogramBins, json["histogram"].as<JsonArray>().size());
+    TEST_ASSERT_EQUAL_size_t(CalibrationReport::points, json["inl"].as<JsonArray>().size());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_report_of_good_calibration);
+    RUN_TEST(test_inl_and_dnl_agree);
+    RUN_TEST(test_stuck_band_gives_missing_codes);
+    RUN_TEST(test_drifting_board_fails);
+    RUN_TEST(test_report_saved_as_json);
+    return UNITY_END();
+}
@@ -0,0 +1,110 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <math.h>
+
+static LinarRamStorage *storage;
+
+// Code the default model's bow should be corrected to, for a raw code
+static float idealCode(int raw, int bits) {
+    float y = (float)raw / (1 << bits);
+    return (-0.94f + sqrtf(0.94f * 0.94f + 0.24f * y)) / 0.12f * (1 << bits);
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+static void assertCalibratesAt(uint8_t bits) {
+    int size = 1 << bits;
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.setResolution(bits));
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_EQUAL_UINT32((size + 1) * sizeof(int), storage->size("/CalibrationResults.bin"));
+
+    LinarADC rebooted;
+    rebooted.useStorage(*storage);
+    TEST_ASSERT_TRUE(rebooted.setResolution(bits));
+    TEST_ASSERT_TRUE(rebooted.begin());
+    TEST_ASSERT_EQUAL_INT(bits, rebooted.getResolution());
+
+    int previous = 0;
+    for (int raw = 0; raw < size; raw++) {
+        int code = rebooted.convert(raw);
+        TEST_ASSERT_TRUE(code >= previous && code < size);
+        previous = code;
+        if (raw >= size / 32 && raw < size - size / 32) TEST_ASSERT_INT_WITHIN(2, lroundf(idealCode(raw, bits)), code);
+    }
+}
+
+void test_calibrates_at_9_bits() {
+    assertCalibratesAt(9);
+}
+
+void test_calibrates_at_10_bits() {
+    assertCalibratesAt(10);
+}
+
+void test_calibrates_at_11_bits() {
+    assertCalibratesAt(11);
+}
+
+void test_calibrates_at_12_bits() {
+    assertCalibratesAt(12);
+}
+
+void test_rejects_unsupported_resolutions() {
+    LinarADC adc;
+    TEST_ASSERT_FALSE(adc.setResolution(8));
+    TEST_ASSERT_FALSE(adc.setResolution(13));
+    TEST_ASSERT_EQUAL_INT(12, adc.getResolution());
+}
+
+void test_table_saved_at_another_resolution_is_rejected() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+
+    LinarADC narrow;
+    narrow.useStorage(*storage);
+    TEST_ASSERT_TRUE(narrow.setResolution(10));
+    TEST_ASSERT_FALSE(narrow.begin());
+    for (int raw = 0; raw < 1024; raw += 31) TEST_ASSERT_TRUE(narrow.convert(raw) < 1024);
+}
+
+void test_channels_at_different_resolutions_mix() {
+    LinarADC wide(34, ".bin", -1, -1, "Wide");
+    LinarADC narrow(34, ".bin", -1, -1, "Narrow");
+    wide.useStorage(*storage);
+    narrow.useStorage(*storage);
+    TEST_ASSERT_TRUE(narrow.setResolution(9));
+    TEST_ASSERT_TRUE(wide.save());
+    TEST_ASSERT_TRUE(narrow.save());
+    TEST_ASSERT_TRUE(wide.begin());
+    TEST_ASSERT_TRUE(narrow.begin());
+
+    // Each read sets the width it needs, whatever the other channel left
+    dac_output_voltage(DAC_CHANNEL_1, 128);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_INT_WITHIN(8, 2048, wide.read(34));
+        TEST_ASSERT_INT_WITHIN(2, 256, narrow.read(34));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_calibrates_at_9_bits);
+    RUN_TEST(test_calibrates_at_10_bits);
+    RUN_TEST(test_calibrates_at_11_bits);
+    RUN_TEST(test_calibrates_at_12_bits);
+    RUN_TEST(test_rejects_unsupported_resolutions);
+    RUN_TEST(test_table_saved_at_another_resolution_is_rejected);
+    RUN_TEST(test_channels_at_different_resolutions_mix);
+    return UNITY_END();
+}
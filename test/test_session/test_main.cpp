@@ -0,0 +1,99 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <SPIFFS.h>
+
+static int mountCalls;
+static bool lastFormatOnFail;
+
+static bool mountSpiffs(bool formatOnFail) {
+    mountCalls++;
+    lastFormatOnFail = formatOnFail;
+    return SPIFFS.begin(formatOnFail);
+}
+
+void setUp() {
+    linarHostReset();
+    SPIFFS.end();
+    SPIFFS.failMount = false;
+    mountCalls = 0;
+    lastFormatOnFail = true;
+}
+
+void tearDown() {
+    SPIFFS.failMount = false;
+}
+
+void test_channels_mount_once() {
+    LinarFsSession session(SPIFFS, mountSpiffs);
+    LinarFsStorage storage(session);
+    int mountsBefore = SPIFFS.mounts;
+    {
+        LinarADC ch0(34, ".bin", -1, -1, "Ch0");
+        LinarADC ch1(35, ".bin", -1, -1, "Ch1");
+        LinarADC ch2(36, ".bin", -1, -1, "Ch2");
+        LinarADC *channels[] = {&ch0, &ch1, &ch2};
+        for (LinarADC *adc : channels) {
+            adc->useStorage(storage);
+            TEST_ASSERT_TRUE(adc->save());
+            TEST_ASSERT_TRUE(adc->begin());
+        }
+    }
+
+    TEST_ASSERT_TRUE(session.isMounted());
+    TEST_ASSERT_EQUAL_INT(1, mountCalls);
+    TEST_ASSERT_EQUAL_INT(1, SPIFFS.mounts - mountsBefore);
+    TEST_ASSERT_EQUAL_UINT32(1, session.getMountCount());
+    TEST_ASSERT_EQUAL_UINT32(1, session.getMountAttempts());
+    TEST_ASSERT_EQUAL_UINT32(session.getLastMountMicros(), session.getTotalMountMicros());
+}
+
+void test_format_is_off_by_default() {
+    TEST_ASSERT_FALSE(LinarFsSession::spiffs().formatOnFail);
+    TEST_ASSERT_FALSE(LinarFsSession::littleFs().formatOnFail);
+
+    LinarFsSession session(SPIFFS, mountSpiffs);
+    TEST_ASSERT_TRUE(session.mount());
+    TEST_ASSERT_FALSE(lastFormatOnFail);
+
+    LinarFsSession optedIn(SPIFFS, mountSpiffs);
+    optedIn.formatOnFail = true;
+    TEST_ASSERT_TRUE(optedIn.mount());
+    TEST_ASSERT_TRUE(lastFormatOnFail);
+}
+
+void test_failed_mount_is_retried() {
+    LinarFsSession session(SPIFFS, mountSpiffs);
+    LinarFsStorage storage(session);
+    LinarADC adc;
+    adc.useStorage(storage);
+
+    SPIFFS.failMount = true;
+    TEST_ASSERT_FALSE(adc.save());
+    TEST_ASSERT_FALSE(session.isMounted());
+    TEST_ASSERT_EQUAL_UINT32(0, session.getMountCount());
+    TEST_ASSERT_EQUAL_UINT32(1, session.getMountAttempts());
+
+    SPIFFS.failMount = false;
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    TEST_ASSERT_EQUAL_UINT32(1, session.getMountCount());
+    TEST_ASSERT_EQUAL_UINT32(2, session.getMountAttempts());
+    TEST_ASSERT_GREATER_THAN(0, (int)session.getLastMountMicros());
+    TEST_ASSERT_GREATER_THAN((int)session.getLastMountMicros(), (int)session.getTotalMountMicros());
+
+    // Unmounted behind the session's back: invalidate() makes it mount again
+    SPIFFS.end();
+    session.invalidate();
+    TEST_ASSERT_TRUE(adc.begin());
+    TEST_ASSERT_EQUAL_UINT32(2, session.getMountCount());
+    TEST_ASSERT_EQUAL_UINT32(3, session.getMountAttempts());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_channels_mount_once);
+    RUN_TEST(test_format_is_off_by_default);
+    RUN_TEST(test_failed_mount_is_retried);
+    return UNITY_END();
+}
@@ -0,0 +1,216 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+#include <TornStorage.h>
+#include <SPIFFS.h>
+#include <vector>
+
+static TornStorage *backend;
+
+static std::vector<uint8_t> blob(int seed, size_t length) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; i++) data[i] = (uint8_t)(seed * 13 + i * 5);
+    return data;
+}
+
+static bool holds(LinarStorage &store, const char *key, const std::vector<uint8_t> &expected) {
+    std::vector<uint8_t> data(expected.size());
+    return store.size(key) == expected.size() &&
+           store.read(key, 0, data.data(), data.size()) == data.size() && data == expected;
+}
+
+void setUp() {
+    linarHostReset();
+    backend = new TornStorage();
+}
+
+void tearDown() {
+    delete backend;
+}
+
+void test_writes_alternate_slots() {
+    LinarSlotStorage slots(*backend);
+    TEST_ASSERT_TRUE(slots.write("/t.bin", blob(1, 100).data(), 100));
+    TEST_ASSERT_EQUAL_INT('a', slots.activeSlot("/t.bin"));
+    TEST_ASSERT_TRUE(slots.write("/t.bin", blob(2, 100).data(), 100));
+    TEST_ASSERT_EQUAL_INT('b', slots.activeSlot("/t.bin"));
+    TEST_ASSERT_TRUE(holds(slots, "/t.bin", blob(2, 100)));
+
+    LinarSlotStorage reopened(*backend);
+    TEST_ASSERT_TRUE(holds(reopened, "/t.bin", blob(2, 100)));
+}
+
+void test_corrupt_slot_falls_back_to_previous() {
+    {
+        LinarSlotStorage slots(*backend);
+        slots.write("/t.bin", blob(1, 100).data(), 100);
+        slots.write("/t.bin", blob(2, 100).data(), 100);
+    }
+    uint8_t flipped = 0xFF;
+    backend->blobs.writeAt("/t.bin.b", 40, &flipped, 1);
+
+    LinarSlotStorage slots(*backend);
+    TEST_ASSERT_TRUE(holds(slots, "/t.bin", blob(1, 100)));
+    TEST_ASSERT_EQUAL_INT('a', slots.activeSlot("/t.bin"));
+
+    // The bad slot is gone, so a reset does not pick it again
+    LinarSlotStorage reopened(*backend);
+    TEST_ASSERT_EQUAL_INT('a', reopened.activeSlot("/t.bin"));
+    TEST_ASSERT_TRUE(holds(reopened, "/t.bin", blob(1, 100)));
+}
+
+void test_save_survives_power_loss_at_every_byte() {
+    std::vector<uint8_t> before = blob(1, 200);
+    std::vector<uint8_t> after = blob(2, 200);
+    unsigned long saveBytes;
+    {
+        LinarSlotStorage slots(*backend);
+        slots.write("/t.bin", before.data(), before.size());
+        unsigned long start = backend->bytesWritten();
+        slots.write("/t.bin", after.data(), after.size());
+        saveBytes = backend->bytesWritten() - start;
+    }
+
+    for (unsigned long cut = 0; cut < saveBytes; cut++) {
+        delete backend;
+        backend = new TornStorage();
+        {
+            LinarSlotStorage slots(*backend);
+            TEST_ASSERT_TRUE(slots.write("/t.bin", before.data(), before.size()));
+            backend->powerLossAfter(cut);
+            TEST_ASSERT_FALSE(slots.write("/t.bin", after.data(), after.size()));
+            backend->powerBack();
+        }
+        LinarSlotStorage slots(*backend);
+        TEST_ASSERT_TRUE(holds(slots, "/t.bin", before));
+    }
+}
+
+// Moves 100 codes once the 256 x 500 sweep samples are taken, before the check
+static uint32_t samples;
+static int driftAfterSweep(int pin, int bits) {
+    int offset = ++samples > 256 * 500 ? 100 : 0;
+    return constrain(linarHostDefaultAdc(pin, bits) + offset, 0, (1 << bits) - 1);
+}
+
+void test_failed_check_keeps_previous_calibration() {
+    static int previous[4096];
+    LinarSlotStorage slots(*backend);
+    LinarADC adc;
+    adc.useStorage(slots);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    for (int raw = 0; raw < 4096; raw++) previous[raw] = adc.convert(raw);
+
+    samples = 0;
+    linarHostSetAdcModel(driftAfterSweep);
+    TEST_ASSERT_FALSE(adc.save());
+    TEST_ASSERT_FALSE(adc.getReport().passed);
+
+    LinarSlotStorage reopened(*backend);
+    LinarADC rebooted;
+    rebooted.useStorage(reopened);
+    TEST_ASSERT_TRUE(rebooted.begin());
+    for (int raw = 0; raw < 4096; raw++) TEST_ASSERT_EQUAL_INT(previous[raw], rebooted.convert(raw));
+}
+
+void test_partition_directory_survives_power_loss() {
+    std::vector<uint8_t> kept = blob(3, 5000);
+    std::vector<uint8_t> before = blob(1, 3000);
+    std::vector<uint8_t> after = blob(2, 3000);
+
+    for (long operations = 0; operations < 24; operations++) {
+        linarHostReset();
+        linarHostAddPartition("calib", 64 * 1024);
+        {
+            LinarPartitionStorage partition("calib");
+            LinarSlotStorage slots(partition);
+            TEST_ASSERT_TRUE(slots.begin());
+            TEST_ASSERT_TRUE(partition.write("/kept", kept.data(), kept.size()));
+            TEST_ASSERT_TRUE(slots.write("/t.bin", before.data(), before.size()));
+
+            linarHostFailFlashAfter(operations);
+            slots.write("/t.bin", after.data(), after.size());
+            partition.write("/new", kept.data(), kept.size());
+            linarHostFailFlashAfter(-1);
+        }
+
+        LinarPartitionStorage partition("calib");
+        LinarSlotStorage slots(partition);
+        TEST_ASSERT_TRUE(slots.begin());
+        TEST_ASSERT_TRUE(holds(partition, "/kept", kept));
+        TEST_ASSERT_TRUE(holds(slots, "/t.bin", before) || holds(slots, "/t.bin", after));
+    }
+}
+
+void test_partition_write_keeps_previous_version() {
+    std::vector<uint8_t> before = blob(1, 5000);
+    for (size_t length : {5000, 9000}) {
+        std::vector<uint8_t> after = blob(2, length);
+        for (long operations = 0; operations < 8; operations++) {
+            linarHostReset();
+            linarHostAddPartition("calib", 64 * 1024);
+            {
+                LinarPartitionStorage partition("calib");
+                TEST_ASSERT_TRUE(partition.begin());
+                TEST_ASSERT_TRUE(partition.write("/t.bin", before.data(), before.size()));
+                linarHostFailFlashAfter(operations);
+                partition.write("/t.bin", after.data(), after.size());
+                linarHostFailFlashAfter(-1);
+            }
+
+            LinarPartitionStorage partition("calib");
+            TEST_ASSERT_TRUE(partition.begin());
+            TEST_ASSERT_TRUE(holds(partition, "/t.bin", before) || holds(partition, "/t.bin", after));
+        }
+    }
+}
+
+void test_partition_write_spares_mapped_extents() {
+    linarHostAddPartition("calib", 64 * 1024);
+    LinarPartitionStorage partition("calib");
+    TEST_ASSERT_TRUE(partition.begin());
+    std::vector<uint8_t> first = blob(1, 3000);
+    TEST_ASSERT_TRUE(partition.write("/t.bin", first.data(), first.size()));
+
+    size_t length = 0;
+    const uint8_t *mapped = partition.map("/t.bin", length);
+    TEST_ASSERT_NOT_NULL(mapped);
+    for (int version = 2; version < 6; version++) {
+        TEST_ASSERT_TRUE(partition.write("/t.bin", blob(version, 3000).data(), 3000));
+        TEST_ASSERT_TRUE(holds(partition, "/t.bin", blob(version, 3000)));
+    }
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(first.data(), mapped, first.size());
+    partition.unmap(mapped);
+}
+
+void test_keys_fit_spiffs_names() {
+    LinarSlotStorage slots(LinarFsStorage::spiffs());
+    TEST_ASSERT_TRUE(slots.begin());
+    const char *longest = "/abcdefghijklmnopqrstuvwx.bin";     // 29 characters
+    TEST_ASSERT_TRUE(slots.write(longest, blob(1, 10).data(), 10));
+    TEST_ASSERT_TRUE(holds(slots, longest, blob(1, 10)));
+    TEST_ASSERT_FALSE(slots.write("/abcdefghijklmnopqrstuvwxy.bin", blob(1, 10).data(), 10));
+
+    // Every file of a default channel on the default storage
+    LinarADC adc(34, ".points");
+    adc.recordSweeps = true;
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(SPIFFS.exists("/CalibrationResults.points.a"));
+    TEST_ASSERT_TRUE(SPIFFS.exists("/CalibrationResults.sweep.a"));
+    TEST_ASSERT_TRUE(SPIFFS.exists("/CalibrationResults.rpt.a"));
+    TEST_ASSERT_TRUE(adc.begin());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_writes_alternate_slots);
+    RUN_TEST(test_corrupt_slot_falls_back_to_previous);
+    RUN_TEST(test_save_survives_power_loss_at_every_byte);
+    RUN_TEST(test_failed_check_keeps_previous_calibration);
+    RUN_TEST(test_partition_directory_survives_power_loss);
+    RUN_TEST(test_partition_write_keeps_previous_version);
+    RUN_TEST(test_partition_write_spares_mapped_extents);
+    RUN_TEST(test_keys_fit_spiffs_names);
+    return UNITY_END();
+}
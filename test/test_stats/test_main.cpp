@@ -0,0 +1,77 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+
+static LinarRamStorage *storage;
+static uint32_t reads;
+
+// Every conversion takes 3 us of host time
+static int slowAdc(int pin, int bits) {
+    reads++;
+    linarHostAdvanceMicros(3);
+    return linarHostDefaultAdc(pin, bits);
+}
+
+void setUp() {
+    linarHostReset();
+    linarHostSetAdcModel(slowAdc);
+    storage = new LinarRamStorage();
+    reads = 0;
+}
+
+void tearDown() {
+    delete storage;
+}
+
+void test_save_records_every_phase() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    uint32_t start = micros();
+    TEST_ASSERT_TRUE(adc.save());
+    uint32_t elapsed = micros() - start;
+
+    const LinarPhaseStats &stats = adc.getStats();
+    for (int p = 0; p < LinarPhaseStats::phaseCount; p++) {
+        LinarPhase phase = (LinarPhase)p;
+        TEST_ASSERT_EQUAL_UINT32(1, stats.countOf(phase));
+        TEST_ASSERT_GREATER_THAN(0, (int)stats.microsOf(phase));
+        TEST_ASSERT_GREATER_THAN(0, (int)stats.cyclesOf(phase));
+    }
+
+    // The sweep holds nearly every conversion, the verification the rest
+    TEST_ASSERT_EQUAL_UINT32(500 * 256, stats.samples);
+    TEST_ASSERT_GREATER_OR_EQUAL(3 * stats.samples, stats.microsOf(LinarPhase::Sweep));
+    TEST_ASSERT_GREATER_OR_EQUAL(3 * (reads - stats.samples), stats.microsOf(LinarPhase::Verify));
+    TEST_ASSERT_LESS_OR_EQUAL(elapsed, stats.totalMicros());
+    TEST_ASSERT_GREATER_OR_EQUAL((int)(sizeof(int) * 4096), (int)stats.bytesWritten);
+}
+
+void test_stats_start_over_with_each_run() {
+    LinarADC ch0(34, ".bin", -1, -1, "Ch0");
+    LinarADC ch1(35, ".bin", -1, -1, "Ch1");
+    ch0.useStorage(*storage);
+    ch1.useStorage(*storage);
+    TEST_ASSERT_TRUE(ch0.save());
+    TEST_ASSERT_TRUE(ch0.save());
+    TEST_ASSERT_EQUAL_UINT32(1, ch0.getStats().countOf(LinarPhase::Sweep));
+
+    // A batch charges the shared sweep to each channel
+    LinarADC *channels[] = {&ch0, &ch1};
+    dac_channel_t dacs[] = {DAC_CHANNEL_1, DAC_CHANNEL_1};
+    TEST_ASSERT_TRUE(LinarADC::saveBatch(channels, dacs, 2));
+    for (LinarADC *adc : channels) {
+        const LinarPhaseStats &stats = adc->getStats();
+        for (int p = 0; p < LinarPhaseStats::phaseCount; p++) {
+            TEST_ASSERT_EQUAL_UINT32(1, stats.countOf((LinarPhase)p));
+        }
+        TEST_ASSERT_EQUAL_UINT32(500 * 256, stats.samples);
+    }
+    TEST_ASSERT_EQUAL_UINT32(ch0.getStats().microsOf(LinarPhase::Sweep), ch1.getStats().microsOf(LinarPhase::Sweep));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_save_records_every_phase);
+    RUN_TEST(test_stats_start_over_with_each_run);
+    return UNITY_END();
+}
@@ -0,0 +1,215 @@
+#include <unity.h>
+#include <LinarTableStore.h>
+#include <LinarHost.h>
+#include <TornStorage.h>
+#include <thread>
+#include <vector>
+
+static TornStorage *backend;
+
+static std::vector<uint8_t> table(int seed, size_t length) {
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; i++) data[i] = (uint8_t)(seed * 31 + i * 7);
+    return data;
+}
+
+static bool holds(LinarTableStore &store, const char *key, const std::vector<uint8_t> &expected) {
+    std::vector<uint8_t> data(expected.size());
+    return store.size(key) == expected.size() &&
+           store.read(key, 0, data.data(), data.size()) == data.size() && data == expected;
+}
+
+void setUp() {
+    linarHostReset();
+    backend = new TornStorage();
+}
+
+void tearDown() {
+    delete backend;
+}
+
+void test_tables_survive_reopen() {
+    {
+        LinarTableStore store(*backend);
+        TEST_ASSERT_TRUE(store.begin());
+        for (int i = 0; i < 5; i++) {
+            String key = "/Ch" + String(i) + ".bin";
+            TEST_ASSERT_TRUE(store.write(key.c_str(), table(i, 100 + i).data(), 100 + i));
+        }
+    }
+    LinarTableStore store(*backend);
+    TEST_ASSERT_TRUE(store.begin());
+    TEST_ASSERT_EQUAL_INT(5, store.count());
+    for (int i = 0; i < 5; i++) {
+        String key = "/Ch" + String(i) + ".bin";
+        TEST_ASSERT_TRUE(holds(store, key.c_str(), table(i, 100 + i)));
+    }
+}
+
+void test_last_slot_kept_for_updates() {
+    LinarTableStore store(*backend);
+    TEST_ASSERT_TRUE(store.begin());
+    for (int i = 0; i < LinarTableStore::capacity - 1; i++) {
+        String key = "/T" + String(i);
+        TEST_ASSERT_TRUE(store.write(key.c_str(), table(i, 16).data(), 16));
+    }
+    TEST_ASSERT_FALSE(store.write("/OneTooMany", table(99, 16).data(), 16));
+    TEST_ASSERT_EQUAL_INT(LinarTableStore::capacity - 1, store.count());
+
+    // A full store still takes updates, again and again
+    for (int round = 0; round < 3; round++) {
+        TEST_ASSERT_TRUE(store.write("/T3", table(100 + round, 32).data(), 32));
+        TEST_ASSERT_TRUE(holds(store, "/T3", table(100 + round, 32)));
+    }
+    TEST_ASSERT_TRUE(store.writeAt("/T4", 0, table(7, 4).data(), 4));
+}
+
+void test_update_survives_power_loss_at_every_byte() {
+    std::vector<uint8_t> before = table(1, 300);
+    std::vector<uint8_t> after = table(2, 300);
+    std::vector<uint8_t> other = table(3, 50);
+
+    // How many bytes an update writes
+    unsigned long updateBytes;
+    {
+        LinarTableStore store(*backend);
+        store.begin();
+        store.write("/A", before.data(), before.size());
+        unsigned long start = backend->bytesWritten();
+        store.write("/A", after.data(), after.size());
+        updateBytes = backend->bytesWritten() - start;
+    }
+
+    for (unsigned long cut = 0; cut <= updateBytes; cut++) {
+        delete backend;
+        backend = new TornStorage();
+        {
+            LinarTableStore store(*backend);
+            TEST_ASSERT_TRUE(store.begin());
+            TEST_ASSERT_TRUE(store.write("/A", before.data(), before.size()));
+            TEST_ASSERT_TRUE(store.write("/B", other.data(), other.size()));
+            backend->powerLossAfter(cut);
+            store.write("/A", after.data(), after.size());
+            backend->powerBack();
+        }
+
+        LinarTableStore store(*backend);
+        TEST_ASSERT_TRUE(store.begin());
+        bool old = holds(store, "/A", before);
+        bool updated = holds(store, "/A", after);
+        if (!old && !updated) {
+            char message[64];
+            snprintf(message, sizeof(message), "table lost with power cut after %lu bytes", cut);
+            TEST_FAIL_MESSAGE(message);
+        }
+        TEST_ASSERT_TRUE(cut < updateBytes || updated);
+        TEST_ASSERT_TRUE(holds(store, "/B", other));
+        TEST_ASSERT_EQUAL_INT(2, store.count());
+    }
+}
+
+void test_update_on_partition_survives_power_loss() {
+    // Large enough that the update outgrows the first sector of the container
+    std::vector<uint8_t> before = table(1, 3000);
+    std::vector<uint8_t> after = table(2, 3000);
+    std::vector<uint8_t> other = table(3, 50);
+
+    uint32_t updateOperations = 0;
+    for (long operations = 0; operations <= (long)updateOperations; operations++) {
+        linarHostReset();
+        linarHostAddPartition("calib", 128 * 1024);
+        {
+            LinarPartitionStorage partition("calib");
+            LinarTableStore store(partition);
+            TEST_ASSERT_TRUE(store.begin());
+            TEST_ASSERT_TRUE(store.write("/A", before.data(), before.size()));
+            TEST_ASSERT_TRUE(store.write("/B", other.data(), other.size()));
+            uint32_t start = linarHostFlashOperations();
+            if (operations == 0) {
+                // First pass only counts the flash operations of a whole update
+                TEST_ASSERT_TRUE(store.write("/A", after.data(), after.size()));
+                updateOperations = linarHostFlashOperations() - start;
+                continue;
+            }
+            linarHostFailFlashAfter(operations - 1);
+            store.write("/A", after.data(), after.size());
+            linarHostFailFlashAfter(-1);
+        }
+
+        LinarPartitionStorage partition("calib");
+        LinarTableStore store(partition);
+        TEST_ASSERT_TRUE(store.begin());
+        if (!holds(store, "/A", before) && !holds(store, "/A", after)) {
+            char message[64];
+            snprintf(message, sizeof(message), "table lost with power cut after %ld operations", operations - 1);
+            TEST_FAIL_MESSAGE(message);
+        }
+        TEST_ASSERT_TRUE(holds(store, "/B", other));
+    }
+    TEST_ASSERT_GREATER_OR_EQUAL(4, (int)updateOperations);
+}
+
+struct Worker {
+    LinarTableStore *store;
+    int id;
+    int failures;
+};
+
+static void hammer(Worker *worker) {
+    String own = "/Own" + String(worker->id);
+    for (int round = 0; round < 200; round++) {
+        std::vector<uint8_t> mine = table(worker->id * 1000 + round, 64 + worker->id);
+        if (!worker->store->write(own.c_str(), mine.data(), mine.size()) ||
+            !holds(*worker->store, own.c_str(), mine)) {
+            worker->failures++;
+        }
+
+        // Shared table: every read must return one whole version
+        uint8_t shared[128];
+        if (worker->store->read("/Shared", 0, shared, sizeof(shared)) != sizeof(shared)) {
+            worker->failures++;
+        }
+        for (size_t i = 1; i < sizeof(shared); i++) {
+            if ((uint8_t)(shared[i] - shared[0]) != (uint8_t)(i * 7)) {
+                worker->failures++;
+                break;
+            }
+        }
+        if (round % 10 == 0) {
+            std::vector<uint8_t> version = table(round, 128);
+            worker->store->write("/Shared", version.data(), version.size());
+        }
+    }
+}
+
+void test_concurrent_tasks() {
+    LinarTableStore store(*backend);
+    TEST_ASSERT_TRUE(store.begin());
+    TEST_ASSERT_TRUE(store.write("/Shared", table(0, 128).data(), 128));
+
+    Worker workers[4];
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        workers[i] = {&store, i, 0};
+        threads.emplace_back(hammer, &workers[i]);
+    }
+    for (std::thread &thread : threads) thread.join();
+
+    for (int i = 0; i < 4; i++) TEST_ASSERT_EQUAL_INT(0, workers[i].failures);
+    TEST_ASSERT_EQUAL_INT(5, store.count());
+    TEST_ASSERT_TRUE(store.compact());
+    for (int i = 0; i < 4; i++) {
+        String own = "/Own" + String(i);
+        TEST_ASSERT_TRUE(holds(store, own.c_str(), table(i * 1000 + 199, 64 + i)));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tables_survive_reopen);
+    RUN_TEST(test_last_slot_kept_for_updates);
+    RUN_TEST(test_update_survives_power_loss_at_every_byte);
+    RUN_TEST(test_update_on_partition_survives_power_loss);
+    RUN_TEST(test_concurrent_tasks);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include <unity.h>
+#include <LinarADC.h>
+#include <LinarHost.h>
+
+static LinarRamStorage *storage;
+static int rawCode;
+
+// Bends the other way from the default model, so the two tables cross
+static int warmAdc(int pin, int bits) {
+    float x = linarHostDacLevel(DAC_CHANNEL_1) / 256.0f;
+    return constrain((int)lroundf((x + 0.08f * x * (1 - x)) * (1 << bits)), 0, (1 << bits) - 1);
+}
+
+static int fixedAdc(int pin, int bits) {
+    return rawCode;
+}
+
+void setUp() {
+    linarHostReset();
+    storage = new LinarRamStorage();
+}
+
+void tearDown() {
+    delete storage;
+}
+
+static void captureTwoTemperatures(LinarADC &adc) {
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(20));
+    linarHostSetAdcModel(warmAdc);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(30));
+    linarHostSetAdcModel(fixedAdc);
+    TEST_ASSERT_TRUE(adc.begin());
+}
+
+static void readTable(LinarADC &adc, int *table) {
+    for (rawCode = 0; rawCode < 4096; rawCode++) table[rawCode] = adc.read(34);
+}
+
+void test_tables_survive_reload() {
+    static int cold[4096], warm[4096], reloaded[4096];
+    LinarADC adc;
+    captureTwoTemperatures(adc);
+    adc.setTemperature(20);
+    readTable(adc, cold);
+    adc.setTemperature(30);
+    readTable(adc, warm);
+
+    LinarADC other;
+    other.useStorage(*storage);
+    TEST_ASSERT_TRUE(other.begin());
+    other.setTemperature(30);
+    readTable(other, reloaded);
+    TEST_ASSERT_EQUAL_INT_ARRAY(warm, reloaded, 4096);
+
+    int differing = 0;
+    for (int i = 0; i < 4096; i++) differing += cold[i] != warm[i];
+    TEST_ASSERT_GREATER_THAN(1000, differing);
+}
+
+void test_blend_rounds_both_ways() {
+    static int cold[4096], warm[4096], blended[4096];
+    LinarADC adc;
+    captureTwoTemperatures(adc);
+    adc.setTemperature(20);
+    readTable(adc, cold);
+    adc.setTemperature(30);
+    readTable(adc, warm);
+
+    for (int degrees = 21; degrees < 30; degrees += 4) {
+        adc.setTemperature(degrees);
+        readTable(adc, blended);
+        long weight = lroundf(256 * (degrees - 20) / 10.0f);
+        for (int i = 0; i < 4096; i++) {
+            TEST_ASSERT_EQUAL_INT(cold[i] + lround((warm[i] - cold[i]) * weight / 256.0), blended[i]);
+        }
+    }
+}
+
+void test_replaces_table_at_same_temperature() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(20));
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(20.3));
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(25));
+
+    uint16_t count = 0;
+    TEST_ASSERT_EQUAL_size_t(2, storage->read("/CalibrationResults.temp", 4, (uint8_t *)&count, 2));
+    TEST_ASSERT_EQUAL_UINT(2, count);
+}
+
+void test_begin_keeps_the_main_table() {
+    static int main[4096], cold[4096], loaded[4096];
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.save());
+    TEST_ASSERT_TRUE(adc.begin());
+    for (int raw = 0; raw < 4096; raw++) main[raw] = adc.convert(raw);
+    linarHostSetAdcModel(warmAdc);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(20));
+
+    LinarADC rebooted;
+    rebooted.useStorage(*storage);
+    TEST_ASSERT_TRUE(rebooted.begin());
+    for (int raw = 0; raw < 4096; raw++) loaded[raw] = rebooted.convert(raw);
+    TEST_ASSERT_EQUAL_INT_ARRAY(main, loaded, 4096);
+
+    rebooted.setTemperature(20);
+    for (int raw = 0; raw < 4096; raw++) cold[raw] = rebooted.convert(raw);
+    int differing = 0;
+    for (int i = 0; i < 4096; i++) differing += cold[i] != main[i];
+    TEST_ASSERT_GREATER_THAN(1000, differing);
+}
+
+void test_begin_blends_without_a_main_table() {
+    static int started[4096], blended[4096];
+    LinarADC adc;
+    captureTwoTemperatures(adc);
+    for (rawCode = 0; rawCode < 4096; rawCode++) started[rawCode] = adc.read(34);
+    adc.setTemperature(25);
+    readTable(adc, blended);
+    TEST_ASSERT_EQUAL_INT_ARRAY(blended, started, 4096);
+}
+
+void test_holds_only_the_tables_in_use() {
+    LinarADC adc;
+    adc.useStorage(*storage);
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(30));
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(10));
+    TEST_ASSERT_TRUE(adc.saveAtTemperature(20));
+
+    float temperatures[3];
+    for (int i = 0; i < 3; i++) {
+        storage->read("/CalibrationResults.temp", 8 + i * (4 + 2 * 4096), (uint8_t *)&temperatures[i], 4);
+    }
+    TEST_ASSERT_EQUAL_FLOAT(10, temperatures[0]);
+    TEST_ASSERT_EQUAL_FLOAT(20, temperatures[1]);
+    TEST_ASSERT_EQUAL_FLOAT(30, temperatures[2]);
+
+    LinarADC rebooted;
+    rebooted.useStorage(*storage);
+    size_t before = linarHostHeapUsed();
+    TEST_ASSERT_TRUE(rebooted.begin());
+    size_t held = linarHostHeapUsed() - before;
+
+    // Three 16-bit tables and the blended active table, not room for all eight
+    size_t needed = 3 * sizeof(int16_t) * 4096 + sizeof(int) * 4096;
+    TEST_ASSERT_GREATER_OR_EQUAL((int)needed, (int)held);
+    TEST_ASSERT_LESS_THAN((int)needed + 1024, (int)held);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_tables_survive_reload);
+    RUN_TEST(test_blend_rounds_both_ways);
+    RUN_TEST(test_replaces_table_at_same_temperature);
+    RUN_TEST(test_begin_keeps_the_main_table);
+    RUN_TEST(test_begin_blends_without_a_main_table);
+    RUN_TEST(test_holds_only_the_tables_in_use);
+    return UNITY_END();
+}